@@ -3,6 +3,11 @@ import random
 import copy
 import time
 
+try:
+    import cyrus as native  # The C++ engine, built with code/setup.py
+except ImportError:
+    native = None
+
 # --- AI and Game Configuration ---
 MAX_SEARCH_TIME = 5  # Maximum time in seconds to think per move
 
@@ -356,9 +361,38 @@ class CyrusEngine:
                 if piece == king_char: return (r, c)
         return None
 
+class NativeEngine:
+    """The C++ engine from the cyrus module, with the interface Game uses"""
+    def __init__(self):
+        self.engine = native.Engine()
+        self.view = memoryview(self.engine)  # The engine's own board, not a copy
+
+    @property
+    def board(self):
+        return [[native.PIECES[p] if p >= 0 else '.' for p in row] for row in self.view.tolist()]
+
+    def _coords(self, move_str):
+        return ((8 - int(move_str[1]), ord(move_str[0]) - ord('a')), (8 - int(move_str[3]), ord(move_str[2]) - ord('a')))
+
+    def find_best_move(self, turn):
+        move_str = self.engine.find_best_move(movetime=int(MAX_SEARCH_TIME * 1000))
+        return self._coords(move_str) if move_str else None
+
+    def make_move(self, move, turn, simulate=False):
+        self.engine.make_move(move)
+
+    def get_all_legal_moves(self, color, captures_only=False, sort=False):
+        moves = [self._coords(m) for m in self.engine.legal_moves(sort=sort)]
+        if captures_only:
+            moves = [m for m in moves if self.view[m[1]] >= 0]
+        return moves
+
+    def is_in_check(self, color):
+        return self.engine.is_in_check()
+
 class Game:
     def __init__(self):
-        self.engine = CyrusEngine()
+        self.engine = NativeEngine() if native else CyrusEngine()
         self.current_turn = 'white'
 
     def print_board(self):
@@ -382,7 +416,7 @@ class Game:
         if not legal_moves:
             winner = 'Black' if self.current_turn == 'white' else 'White'
             if self.engine.is_in_check(self.current_turn): return True, f"Checkmate! {winner} wins."
-            else: return True, f"Stalemate! {winner} wins."
+            else: return True, "Stalemate: the game is drawn."
         return False, None
 
     def play(self):
@@ -0,0 +1,119 @@
+#ifndef ATTACKS_H
+#define ATTACKS_H
+
+#include <cstdint>
+#include "Bitboard.h"
+
+// Attack sets for every piece on every square, built at compile time into one
+// read-only block shared by every engine and thread. The Faras, Fil, Ferz and
+// Shah are leapers, so their attacks never depend on occupancy; the Rukh is
+// the only slider in Shatranj and uses ray tables plus a bit scan.
+namespace attacks {
+
+enum Direction { NORTH, SOUTH, EAST, WEST }; // Towards row 0, row 7, column 7, column 0
+
+struct Tables {
+    uint64_t pawn[2][64]; // Squares a pawn of the given color attacks
+    uint64_t faras[64];
+    uint64_t fil[64];
+    uint64_t ferz[64];
+    uint64_t shah[64];
+    uint64_t rays[4][64];      // Empty-board rook ray from a square, excluding the square
+    uint64_t between[64][64];  // Squares strictly between two squares on a shared rank or file
+    uint64_t line[64][64];     // Whole rank or file through two squares, 0 if they share neither
+};
+
+constexpr uint64_t step_targets(int sq, const int (*deltas)[2], int count) {
+    int r = sq / 8, c = sq % 8;
+    uint64_t result = 0;
+    for (int i = 0; i < count; ++i) {
+        int nr = r + deltas[i][0], nc = c + deltas[i][1];
+        if (nr >= 0 && nr < 8 && nc >= 0 && nc < 8) {
+            result |= square_bb(nr * 8 + nc);
+        }
+    }
+    return result;
+}
+
+constexpr Tables build_tables() {
+    constexpr int WHITE_PAWN_DELTAS[2][2] = {{-1,-1},{-1,1}};
+    constexpr int BLACK_PAWN_DELTAS[2][2] = {{1,-1},{1,1}};
+    constexpr int FARAS_DELTAS[8][2] = {{1,2},{1,-2},{-1,2},{-1,-2},{2,1},{2,-1},{-2,1},{-2,-1}};
+    constexpr int FIL_DELTAS[4][2] = {{2,2},{2,-2},{-2,2},{-2,-2}};
+    constexpr int FERZ_DELTAS[4][2] = {{1,1},{1,-1},{-1,1},{-1,-1}};
+    constexpr int SHAH_DELTAS[8][2] = {{1,0},{-1,0},{0,1},{0,-1},{1,1},{1,-1},{-1,1},{-1,-1}};
+    constexpr int RAY_DELTAS[4][2] = {{-1,0},{1,0},{0,1},{0,-1}}; // Indexed by Direction
+
+    Tables t{};
+    for (int sq = 0; sq < 64; ++sq) {
+        t.pawn[WHITE][sq] = step_targets(sq, WHITE_PAWN_DELTAS, 2);
+        t.pawn[BLACK][sq] = step_targets(sq, BLACK_PAWN_DELTAS, 2);
+        t.faras[sq] = step_targets(sq, FARAS_DELTAS, 8);
+        t.fil[sq] = step_targets(sq, FIL_DELTAS, 4);
+        t.ferz[sq] = step_targets(sq, FERZ_DELTAS, 4);
+        t.shah[sq] = step_targets(sq, SHAH_DELTAS, 8);
+        for (int dir = 0; dir < 4; ++dir) {
+            uint64_t ray = 0;
+            int r = sq / 8 + RAY_DELTAS[dir][0], c = sq % 8 + RAY_DELTAS[dir][1];
+            while (r >= 0 && r < 8 && c >= 0 && c < 8) {
+                ray |= square_bb(r * 8 + c);
+                r += RAY_DELTAS[dir][0]; c += RAY_DELTAS[dir][1];
+            }
+            t.rays[dir][sq] = ray;
+        }
+    }
+    for (int a = 0; a < 64; ++a) {
+        for (int dir = 0; dir < 4; ++dir) {
+            int opposite = dir ^ 1; // NORTH <-> SOUTH, EAST <-> WEST
+            uint64_t ray = t.rays[dir][a];
+            while (ray) {
+                int b = pop_lsb(ray);
+                t.between[a][b] = t.rays[dir][a] & t.rays[opposite][b];
+                t.line[a][b] = t.rays[dir][a] | t.rays[opposite][a] | square_bb(a);
+            }
+        }
+    }
+    return t;
+}
+
+inline constexpr Tables TABLES = build_tables();
+
+inline constexpr const auto& PAWN_ATTACKS = TABLES.pawn;
+inline constexpr const auto& FARAS_ATTACKS = TABLES.faras;
+inline constexpr const auto& FIL_ATTACKS = TABLES.fil;
+inline constexpr const auto& FERZ_ATTACKS = TABLES.ferz;
+inline constexpr const auto& SHAH_ATTACKS = TABLES.shah;
+inline constexpr const auto& RAYS = TABLES.rays;
+inline constexpr const auto& BETWEEN = TABLES.between;
+inline constexpr const auto& LINE = TABLES.line;
+
+inline int msb(uint64_t b) { return 63 - __builtin_clzll(b); }
+
+inline uint64_t ray_to_blocker(int dir, int sq, uint64_t occupied) {
+    uint64_t ray = RAYS[dir][sq];
+    uint64_t blockers = ray & occupied;
+    if (!blockers) return ray;
+    // SOUTH and EAST rays grow towards higher squares, so the nearest blocker is the lsb
+    int blocker = (dir == SOUTH || dir == EAST) ? lsb(blockers) : msb(blockers);
+    return ray ^ RAYS[dir][blocker];
+}
+
+inline uint64_t rukh_attacks(int sq, uint64_t occupied) {
+    return ray_to_blocker(NORTH, sq, occupied) | ray_to_blocker(SOUTH, sq, occupied)
+         | ray_to_blocker(EAST, sq, occupied) | ray_to_blocker(WEST, sq, occupied);
+}
+
+// All pieces of both colors attacking `sq`, given an occupancy for the rook rays.
+inline uint64_t attackers_to(const Bitboards& bb, int sq, uint64_t occupied) {
+    return (PAWN_ATTACKS[WHITE][sq] & bb.of(PAWN, BLACK))
+         | (PAWN_ATTACKS[BLACK][sq] & bb.of(PAWN, WHITE))
+         | (FARAS_ATTACKS[sq] & (bb.of(FARAS, WHITE) | bb.of(FARAS, BLACK)))
+         | (FIL_ATTACKS[sq] & (bb.of(FIL, WHITE) | bb.of(FIL, BLACK)))
+         | (FERZ_ATTACKS[sq] & (bb.of(FERZ, WHITE) | bb.of(FERZ, BLACK)))
+         | (SHAH_ATTACKS[sq] & (bb.of(SHAH, WHITE) | bb.of(SHAH, BLACK)))
+         | (rukh_attacks(sq, occupied) & (bb.of(RUKH, WHITE) | bb.of(RUKH, BLACK)));
+}
+
+} // namespace attacks
+
+#endif // ATTACKS_H
@@ -0,0 +1,71 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+
+// Squares are numbered 0-63 from a8 (row 0, column 0) to h1 (row 7, column 7),
+// the same numbering Move::from / Move::to use.
+
+enum Color { BLACK = 0, WHITE = 1 };
+enum PieceType { PAWN, FARAS, FIL, RUKH, FERZ, SHAH }; // Pawn, Knight, Elephant, Rook, Counselor, King
+
+// Pieces are indexed type * 2 + color, the order of the Zobrist keys and of
+// the FEN letters in PIECE_CHARS ('p' = 0, 'P' = 1, ..., 'k' = 10, 'K' = 11).
+constexpr int NO_PIECE = -1;
+constexpr char PIECE_CHARS[] = "pPnNbBrRqQkK";
+
+constexpr int piece_from_char(char c) {
+    for (int piece = 0; piece < 12; ++piece) {
+        if (PIECE_CHARS[piece] == c) return piece;
+    }
+    return NO_PIECE;
+}
+
+constexpr int make_piece(int type, int color) { return type * 2 + color; }
+constexpr int piece_type(int piece) { return piece >> 1; }
+constexpr int piece_color(int piece) { return piece & 1; }
+
+constexpr uint64_t square_bb(int sq) { return 1ULL << sq; }
+constexpr int popcount(uint64_t b) { return __builtin_popcountll(b); }
+constexpr int lsb(uint64_t b) { return __builtin_ctzll(b); }
+constexpr int pop_lsb(uint64_t& b) {
+    int sq = lsb(b);
+    b &= b - 1;
+    return sq;
+}
+
+// Bitboard position: one set per piece type and color, occupancy masks, and a
+// square -> piece mailbox so make_move can find what stands on a square in O(1).
+struct Bitboards {
+    uint64_t pieces[12];
+    uint64_t occupancy[2]; // By color
+    uint64_t occupied;
+    int8_t mailbox[64];
+
+    constexpr void clear() {
+        for (auto& b : pieces) b = 0;
+        occupancy[BLACK] = occupancy[WHITE] = occupied = 0;
+        for (auto& p : mailbox) p = NO_PIECE;
+    }
+
+    constexpr void put(int piece, int sq) {
+        uint64_t b = square_bb(sq);
+        pieces[piece] |= b;
+        occupancy[piece_color(piece)] |= b;
+        occupied |= b;
+        mailbox[sq] = static_cast<int8_t>(piece);
+    }
+
+    constexpr void remove(int piece, int sq) {
+        uint64_t b = ~square_bb(sq);
+        pieces[piece] &= b;
+        occupancy[piece_color(piece)] &= b;
+        occupied &= b;
+        mailbox[sq] = NO_PIECE;
+    }
+
+    constexpr int piece_on(int sq) const { return mailbox[sq]; }
+    constexpr uint64_t of(int type, int color) const { return pieces[make_piece(type, color)]; }
+};
+
+#endif // BITBOARD_H
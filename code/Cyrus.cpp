@@ -1,73 +1,64 @@
 #include "Cyrus.h"
+#include "Attacks.h"
+#include "Evaluation.h"
+#include "MovePicker.h"
 #include <iostream>
 #include <algorithm>
 #include <random>
 #include <stdexcept>
+#include <thread>
+#include <cstdlib>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+std::string format_move(const Move& move) {
+    if (move.from == -1) return "NULL";
+    std::string str;
+    str += (char)('a' + (move.from % 8));
+    str += std::to_string(8 - (move.from / 8));
+    str += (char)('a' + (move.to % 8));
+    str += std::to_string(8 - (move.to / 8));
+    return str;
+}
 
 CyrusEngine::CyrusEngine() {
-    board = {
-        {'r', 'n', 'b', 'k', 'q', 'b', 'n', 'r'},
-        {'p', 'p', 'p', 'p', 'p', 'p', 'p', 'p'},
-        {'.', '.', '.', '.', '.', '.', '.', '.'},
-        {'.', '.', '.', '.', '.', '.', '.', '.'},
-        {'.', '.', '.', '.', '.', '.', '.', '.'},
-        {'.', '.', '.', '.', '.', '.', '.', '.'},
-        {'P', 'P', 'P', 'P', 'P', 'P', 'P', 'P'},
-        {'R', 'N', 'B', 'K', 'Q', 'B', 'N', 'R'}
-    };
-    current_turn = 'w';
-
-    piece_values = {{'p', 100}, {'n', 320}, {'b', 280}, {'r', 500}, {'q', 105}, {'k', 20000}};
-
-    pst['p'] = {{0,0,0,0,0,0,0,0},{5,10,10,-20,-20,10,10,5},{5,-5,-10,0,0,-10,-5,5},{0,0,0,20,20,0,0,0},{5,5,10,25,25,10,5,5},{10,10,20,30,30,20,10,10},{50,50,50,50,50,50,50,50},{0,0,0,0,0,0,0,0}};
-    pst['n'] = {{-50,-40,-30,-30,-30,-30,-40,-50},{-40,-20,0,5,5,0,-20,-40},{-30,5,10,15,15,10,5,-30},{-30,0,15,20,20,15,0,-30},{-30,5,15,20,20,15,5,-30},{-30,0,10,15,15,10,0,-30},{-40,-20,0,0,0,0,-20,-40},{-50,-40,-30,-30,-30,-30,-40,-50}};
-    pst['b'] = {{-10,-10,-10,-10,-10,-10,-10,-10},{-10,0,0,0,0,0,0,-10},{-10,0,5,10,10,5,0,-10},{-10,5,5,10,10,5,5,-10},{-10,0,10,10,10,10,0,-10},{-10,10,10,10,10,10,10,-10},{-10,5,0,0,0,0,5,-10},{-10,-10,-10,-10,-10,-10,-10,-10}};
-    pst['r'] = {{0,0,0,5,5,0,0,0},{-5,0,0,0,0,0,0,-5},{-5,0,0,0,0,0,0,-5},{-5,0,0,0,0,0,0,-5},{-5,0,0,0,0,0,0,-5},{-5,0,0,0,0,0,0,-5},{5,10,10,10,10,10,10,5},{0,0,0,0,0,0,0,0}};
-    pst['q'] = {{-10,-10,-10,-5,-5,-10,-10,-10},{-10,0,0,0,0,0,0,-10},{-10,0,5,5,5,5,0,-10},{-5,0,5,5,5,5,0,-5},{0,0,5,5,5,5,0,-5},{-10,5,5,5,5,5,0,-10},{-10,0,5,0,0,0,0,-10},{-10,-10,-10,-5,-5,-10,-10,-10}};
-    pst['k'] = {{20,30,10,0,0,10,30,20},{20,20,0,0,0,0,20,20},{-10,-20,-20,-20,-20,-20,-20,-10},{-20,-30,-30,-40,-40,-30,-30,-20},{-30,-40,-40,-50,-50,-40,-40,-30},{-30,-40,-40,-50,-50,-40,-40,-30},{-30,-40,-40,-50,-50,-40,-40,-30},{-30,-40,-40,-50,-50,-40,-40,-30}};
-    
-    init_zobrist();
-    current_hash = compute_zobrist_hash();
-}
-
-void CyrusEngine::init_zobrist() {
-    std::mt19937_64 engine(0); // Fixed seed for reproducibility
-    std::uniform_int_distribution<uint64_t> dist;
-    piece_keys.resize(12, std::vector<uint64_t>(64));
-    for (int i = 0; i < 12; ++i) {
-        for (int j = 0; j < 64; ++j) {
-            piece_keys[i][j] = dist(engine);
-        }
-    }
-    turn_key = dist(engine);
+    _clear_move_ordering();
 }
 
-uint64_t CyrusEngine::compute_zobrist_hash() const {
-    uint64_t h = 0;
+void CyrusEngine::set_board(const std::vector<std::vector<char>>& layout, char turn) {
+    Bitboards board;
+    board.clear();
     for (int r = 0; r < 8; ++r) {
         for (int c = 0; c < 8; ++c) {
-            char piece = board[r][c];
-            if (piece != '.') {
-                h ^= piece_keys[piece_map(piece)][r * 8 + c];
+            int piece = piece_from_char(layout[r][c]);
+            if (piece != NO_PIECE) {
+                board.put(piece, r * 8 + c);
             }
         }
     }
-    if (current_turn == 'w') {
-        h ^= turn_key;
-    }
-    return h;
+    position.set(board, color_index(turn));
 }
 
-int CyrusEngine::piece_map(char p) const {
-    switch(p) {
-        case 'p': return 0; case 'P': return 1;
-        case 'n': return 2; case 'N': return 3;
-        case 'b': return 4; case 'B': return 5;
-        case 'r': return 6; case 'R': return 7;
-        case 'q': return 8; case 'Q': return 9;
-        case 'k': return 10; case 'K': return 11;
-        default: return -1;
+bool CyrusEngine::set_fen(const std::string& fen) {
+    return position.set_fen(fen);
+}
+
+std::string CyrusEngine::get_fen() const {
+    return position.fen();
+}
+
+std::vector<std::vector<char>> CyrusEngine::get_board() const {
+    std::vector<std::vector<char>> view(8, std::vector<char>(8));
+    for (int sq = 0; sq < 64; ++sq) {
+        view[sq / 8][sq % 8] = piece_at(sq);
     }
+    return view;
+}
+
+char CyrusEngine::piece_at(int square) const {
+    int piece = position.piece_on(square);
+    return piece == NO_PIECE ? '.' : PIECE_CHARS[piece];
 }
 
 void CyrusEngine::print_board() const {
@@ -76,7 +67,7 @@ void CyrusEngine::print_board() const {
     for (int i = 0; i < 8; ++i) {
         std::cout << 8 - i << "| ";
         for (int j = 0; j < 8; ++j) {
-            std::cout << board[i][j] << " ";
+            std::cout << piece_at(i * 8 + j) << " ";
         }
         std::cout << "|" << 8 - i << std::endl;
     }
@@ -84,396 +75,847 @@ void CyrusEngine::print_board() const {
     std::cout << "  a b c d e f g h\n" << std::endl;
 }
 
-char CyrusEngine::get_piece_color(char p) const {
-    if (p == '.') return ' ';
-    return isupper(p) ? 'w' : 'b';
-}
-
-Move CyrusEngine::find_best_move(char turn) {
-    transposition_table.clear();
+Move CyrusEngine::find_best_move(char turn, const SearchLimits& limits) {
+    search_start_time = std::chrono::steady_clock::now();
+    auto started = search_start_time; // search_start_time moves to the ponderhit, if any
+    stats = SearchStats();
+    stats.threads = std::max(search_threads, 1);
+    if (owns_hash) transposition_table->new_search();
+    _age_move_ordering();
+    position.set_side_to_move(color_index(turn)); // The search works on the side to move
     auto legal_moves = get_all_legal_moves(turn, true);
     if (legal_moves.empty()) {
         return {-1, -1};
     }
-
+    Move book_move;
+    if (book && _probe_book(legal_moves, book_move)) {
+        stats.book_hit = true;
+        stats.time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        if (stats_log) *stats_log << stats.to_json() << std::endl;
+        return book_move;
+    }
+    Move tablebase_move;
+    int tablebase_score;
+    if (tablebases && _probe_tablebase_root(legal_moves, tablebase_move, tablebase_score)) {
+        stats.score = turn == 'w' ? tablebase_score : -tablebase_score;
+        stats.time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        if (stats_log) *stats_log << stats.to_json() << std::endl;
+        return tablebase_move;
+    }
+
+    // Helpers are copies of this engine, so each owns its position while the
+    // transposition table is shared. They deepen on their own until the main
+    // search finishes, filling the table with results the main thread reuses.
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> shared_nodes(0);
+    std::vector<CyrusEngine> helpers(std::max(search_threads - 1, 0), *this);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < helpers.size(); ++i) {
+        helpers[i].stop_flag = &stop;
+        helpers[i].node_counter = &shared_nodes;
+        // Copied from this engine as the last search left it; only the main thread enforces limits
+        helpers[i].external_stop = helpers[i].ponder_flag = nullptr;
+        helpers[i].hard_time_ms = 0;
+        helpers[i].node_limit = 0;
+        helpers[i].can_abort = false;
+        threads.emplace_back(&CyrusEngine::_helper_search, &helpers[i], static_cast<int>(i) + 1);
+    }
+
+    bool unlimited = !limits.soft_time_ms && !limits.hard_time_ms && !limits.nodes && !limits.infinite && !limits.ponder;
+    int max_depth = limits.depth > 0 ? std::min(limits.depth, static_cast<int>(MAX_DEPTH))
+                                     : (unlimited ? SEARCH_DEPTH : MAX_DEPTH);
+    stop_flag = &stop;
+    external_stop = limits.stop;
+    ponder_flag = limits.ponder;
+    hard_time_ms = limits.hard_time_ms;
+    node_limit = limits.nodes;
+    can_abort = false;
+
+    // Iterative deepening: each iteration searches the previous best move first.
+    // An iteration cut short by a hard limit is discarded.
     Move best_move = legal_moves[0];
-    int best_eval;
-
-    if (turn == 'w') {
-        best_eval = -999999;
-        int alpha = -999999;
-        int beta = 999999;
-        for (const auto& move : legal_moves) {
-            char piece = board[move.from / 8][move.from % 8];
-            char captured = board[move.to / 8][move.to % 8];
-            make_move(move);
-            int eval = minimax(SEARCH_DEPTH - 1, alpha, beta, false);
-            unmake_move(move, piece, captured);
-            if (eval > best_eval) {
-                best_eval = eval;
-                best_move = move;
-            }
-            alpha = std::max(alpha, eval);
+    int score = 0;
+    auto iteration_start = std::chrono::steady_clock::now();
+    for (int depth = 1; depth <= max_depth; ++depth) {
+        Move iteration_best;
+        int iteration_score = _aspiration_search(depth, score, iteration_best, best_move);
+        if (_stopped()) break;
+        best_move = iteration_best;
+        score = iteration_score;
+        can_abort = true;
+
+        auto now = std::chrono::steady_clock::now();
+        stats.depth = depth;
+        stats.score = turn == 'w' ? score : -score;
+        stats.iterations.push_back({depth, stats.score, stats.total_nodes(),
+                                    std::chrono::duration<double, std::milli>(now - iteration_start).count()});
+        iteration_start = now;
+
+        if (on_iteration) {
+            SearchInfo info;
+            info.depth = depth;
+            info.score = score;
+            info.nodes = stats.total_nodes() + shared_nodes.load(std::memory_order_relaxed);
+            info.time_ms = std::chrono::duration<double, std::milli>(now - started).count();
+            info.hashfull = transposition_table->hashfull();
+            info.pv = _principal_variation(best_move, depth);
+            on_iteration(info);
         }
-    } else { // Black's turn
-        best_eval = 999999;
-        int alpha = -999999;
-        int beta = 999999;
-        for (const auto& move : legal_moves) {
-            char piece = board[move.from / 8][move.from % 8];
-            char captured = board[move.to / 8][move.to % 8];
-            make_move(move);
-            int eval = minimax(SEARCH_DEPTH - 1, alpha, beta, true);
-            unmake_move(move, piece, captured);
-            if (eval < best_eval) {
-                best_eval = eval;
-                best_move = move;
+
+        // Only a mate within this iteration's depth is proven; a longer one may
+        // come from the table and a deeper search can still find a faster mate
+        if (limits.stop_on_mate && is_mate_score(score) && MATE_SCORE - std::abs(score) <= depth) break;
+        if (external_stop && external_stop->load(std::memory_order_relaxed)) break;
+        if (_pondering()) continue; // The clock starts at the ponderhit
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - search_start_time).count();
+        if (limits.soft_time_ms && elapsed >= limits.soft_time_ms) break;
+    }
+
+    stop = true;
+    for (auto& t : threads) t.join();
+    stop_flag = nullptr;
+    external_stop = ponder_flag = nullptr;
+
+    for (const auto& helper : helpers) stats.merge(helper.stats);
+    stats.time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    if (stats_log) *stats_log << stats.to_json() << std::endl;
+    return best_move;
+}
+
+void CyrusEngine::_check_limits() {
+    // Called once per 1024 nodes or qnodes; helpers report them for the info lines
+    if (node_counter) node_counter->fetch_add(1024, std::memory_order_relaxed);
+    if (!can_abort) return;
+    if (external_stop && external_stop->load(std::memory_order_relaxed)) {
+        stop_flag->store(true, std::memory_order_relaxed);
+    } else if (_pondering()) {
+        return;
+    } else if (node_limit && stats.total_nodes() >= node_limit) {
+        stop_flag->store(true, std::memory_order_relaxed);
+    } else if (hard_time_ms) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - search_start_time).count();
+        if (elapsed >= hard_time_ms) stop_flag->store(true, std::memory_order_relaxed);
+    }
+}
+
+bool CyrusEngine::_pondering() {
+    if (!ponder_flag) return false;
+    if (ponder_flag->load(std::memory_order_relaxed)) return true;
+    ponder_flag = nullptr; // Ponderhit: the time limits count from here
+    search_start_time = std::chrono::steady_clock::now();
+    return false;
+}
+
+std::vector<Move> CyrusEngine::_principal_variation(const Move& best_move, int max_length) {
+    // Follow the table's best moves from the root, stopping at anything
+    // illegal or a repeated position
+    std::vector<Move> pv;
+    std::vector<uint64_t> seen = {position.hash()};
+    Move move = best_move;
+    while (static_cast<int>(pv.size()) < max_length && move.from != -1 && _is_legal(move, current_turn())) {
+        pv.push_back(move);
+        position.make_move(move);
+        if (std::find(seen.begin(), seen.end(), position.hash()) != seen.end()) break;
+        seen.push_back(position.hash());
+        TT_Entry entry;
+        move = transposition_table->probe(position.hash(), entry) && entry.move ? unpack_move(entry.move) : Move{-1, -1};
+    }
+    for (size_t i = 0; i < pv.size(); ++i) position.unmake_move();
+    return pv;
+}
+
+bool CyrusEngine::_probe_tablebase_root(const std::vector<Move>& legal_moves, Move& move, int& score) {
+    // Drawn positions are left to the search, which still sees the tables at
+    // every child and so only has to choose among the drawing moves
+    TablebaseResult root;
+    if (popcount(position.board().occupied) > TablebaseMaterial::MAX_PIECES
+        || !tablebases->probe(position.board(), position.side_to_move(), root) || root.wdl == 0) {
+        return false;
+    }
+    ++stats.tb_hits;
+    score = -INFINITE_SCORE;
+    for (const Move& m : legal_moves) {
+        position.make_move(m);
+        TablebaseResult child;
+        bool found = tablebases->probe(position.board(), position.side_to_move(), child);
+        position.unmake_move();
+        if (found && -_tablebase_score(child) > score) {
+            score = -_tablebase_score(child);
+            move = m;
+        }
+    }
+    return score != -INFINITE_SCORE;
+}
+
+bool CyrusEngine::_probe_book(const std::vector<Move>& legal_moves, Move& move) const {
+    // Entries for other positions with a colliding key, or from a stale book,
+    // can name illegal moves; only legal ones count
+    std::vector<BookEntry> candidates;
+    uint32_t total_weight = 0;
+    for (const BookEntry& e : book->lookup(position.hash())) {
+        if (e.weight && std::find(legal_moves.begin(), legal_moves.end(), unpack_move(e.move)) != legal_moves.end()) {
+            candidates.push_back(e);
+            total_weight += e.weight;
+        }
+    }
+    if (candidates.empty()) return false;
+
+    const BookEntry* chosen = &candidates[0];
+    if (book_random) {
+        static thread_local std::mt19937 rng(std::random_device{}());
+        uint32_t pick = std::uniform_int_distribution<uint32_t>(0, total_weight - 1)(rng);
+        for (const BookEntry& e : candidates) {
+            if (pick < e.weight) {
+                chosen = &e;
+                break;
             }
-            beta = std::min(beta, eval);
+            pick -= e.weight;
         }
     }
-    return best_move;
+    move = unpack_move(chosen->move);
+    return true;
 }
 
-int CyrusEngine::minimax(int depth, int alpha, int beta, bool maximizing_player) {
-    uint64_t hash_key = current_hash;
-    if (transposition_table.count(hash_key) && transposition_table[hash_key].depth >= depth) {
-        TT_Entry entry = transposition_table[hash_key];
-        if (entry.flag == TT_EXACT) return entry.score;
-        if (entry.flag == TT_LOWER) alpha = std::max(alpha, entry.score);
-        if (entry.flag == TT_UPPER) beta = std::min(beta, entry.score);
-        if (alpha >= beta) return entry.score;
+void CyrusEngine::_helper_search(int thread_id) {
+    // Odd helpers skip the even depths so the threads spread over different iterations
+    Move best_move = {-1, -1};
+    int score = 0;
+    for (int depth = 1 + (thread_id & 1); depth <= MAX_DEPTH && !_stopped(); depth += 1 + (thread_id & 1)) {
+        score = _aspiration_search(depth, score, best_move, best_move);
     }
+}
 
-    if (depth == 0) {
-        return quiescence_search(alpha, beta, maximizing_player);
+int CyrusEngine::_aspiration_search(int depth, int previous_score, Move& best_move, const Move& first_move) {
+    // Search a narrow window around the last iteration's score and widen it on
+    // the side that failed until the score lands inside.
+    int delta = ASPIRATION_WINDOW;
+    int alpha = -INFINITE_SCORE, beta = INFINITE_SCORE;
+    if (features.aspiration && depth >= 4 && !is_mate_score(previous_score)) {
+        alpha = previous_score - delta;
+        beta = previous_score + delta;
+    }
+    Move first = first_move;
+    while (true) {
+        int score = _search_root(depth, alpha, beta, best_move, first);
+        if (_stopped()) return score;
+        if (score <= alpha && alpha > -INFINITE_SCORE) {
+            alpha = std::max(score - delta, -static_cast<int>(INFINITE_SCORE));
+        } else if (score >= beta && beta < INFINITE_SCORE) {
+            beta = std::min(score + delta, static_cast<int>(INFINITE_SCORE));
+            first = best_move;
+        } else {
+            return score;
+        }
+        delta *= 2;
     }
+}
 
-    char turn = maximizing_player ? 'w' : 'b';
+int CyrusEngine::_search_root(int depth, int alpha, int beta, Move& best_move, const Move& first_move) {
+    char turn = current_turn();
     auto legal_moves = get_all_legal_moves(turn, true);
-
     if (legal_moves.empty()) {
-        return is_in_check(turn) ? (maximizing_player ? -99999 : 99999) : 0;
-    }
-    
-    int original_alpha = alpha;
-    int original_beta = beta;
-
-    if (maximizing_player) {
-        int max_eval = -999999;
-        for (const auto& move : legal_moves) {
-            char piece = board[move.from / 8][move.from % 8];
-            char captured = board[move.to / 8][move.to % 8];
-            make_move(move);
-            int eval = minimax(depth - 1, alpha, beta, false);
-            unmake_move(move, piece, captured);
-            max_eval = std::max(max_eval, eval);
-            alpha = std::max(alpha, eval);
-            if (beta <= alpha) break;
+        best_move = {-1, -1};
+        return is_in_check(turn) ? -MATE_SCORE : 0;
+    }
+    auto first = std::find(legal_moves.begin(), legal_moves.end(), first_move);
+    if (first != legal_moves.end()) std::rotate(legal_moves.begin(), first, first + 1);
+
+    ++stats.nodes;
+    ++stats.interior_nodes;
+    best_move = legal_moves[0];
+    int best_eval = -INFINITE_SCORE;
+    int searched = 0;
+    for (const auto& move : legal_moves) {
+        ply_moves[0] = move;
+        position.make_move(move);
+        int eval;
+        if (searched == 0 || !features.pvs) {
+            eval = -negamax(depth - 1, 1, -beta, -alpha, true);
+        } else {
+            eval = -negamax(depth - 1, 1, -alpha - 1, -alpha, true);
+            if (eval > alpha && eval < beta) eval = -negamax(depth - 1, 1, -beta, -alpha, true);
         }
-        TT_Entry entry = {depth, max_eval, TT_EXACT};
-        if (max_eval <= original_alpha) entry.flag = TT_UPPER;
-        else if (max_eval >= beta) entry.flag = TT_LOWER;
-        transposition_table[hash_key] = entry;
-        return max_eval;
-    } else {
-        int min_eval = 999999;
-        for (const auto& move : legal_moves) {
-            char piece = board[move.from / 8][move.from % 8];
-            char captured = board[move.to / 8][move.to % 8];
-            make_move(move);
-            int eval = minimax(depth - 1, alpha, beta, true);
-            unmake_move(move, piece, captured);
-            min_eval = std::min(min_eval, eval);
-            beta = std::min(beta, eval);
-            if (beta <= alpha) break;
+        position.unmake_move();
+        if (_stopped()) break;
+        ++searched;
+        if (eval > best_eval) {
+            best_eval = eval;
+            best_move = move;
         }
-        TT_Entry entry = {depth, min_eval, TT_EXACT};
-        if (min_eval <= alpha) entry.flag = TT_UPPER;
-        else if (min_eval >= original_beta) entry.flag = TT_LOWER;
-        transposition_table[hash_key] = entry;
-        return min_eval;
+        if (eval > alpha) alpha = eval;
+        if (alpha >= beta) break;
     }
+    stats.moves_searched += searched;
+    return best_eval;
 }
 
-int CyrusEngine::quiescence_search(int alpha, int beta, bool maximizing_player) {
-    int stand_pat = evaluate_board();
-
-    if (maximizing_player) {
-        alpha = std::max(alpha, stand_pat);
-        if (alpha >= beta) return beta;
-    } else {
-        beta = std::min(beta, stand_pat);
-        if (alpha >= beta) return alpha;
-    }
-
-    char turn = maximizing_player ? 'w' : 'b';
-    auto captures = _generate_pseudo_legal_moves(turn, true);
-
-    for (const auto& move : captures) {
-        char piece = board[move.from / 8][move.from % 8];
-        char captured = board[move.to / 8][move.to % 8];
-        make_move(move);
-        if (!is_in_check(turn)) { // only consider legal captures
-            int score = quiescence_search(alpha, beta, !maximizing_player);
-            if (maximizing_player) {
-                alpha = std::max(alpha, score);
-                if (alpha >= beta) {
-                    unmake_move(move, piece, captured);
-                    return beta;
-                }
-            } else {
-                beta = std::min(beta, score);
-                if (alpha >= beta) {
-                    unmake_move(move, piece, captured);
-                    return alpha;
+// Late move reduction in plies for the n-th move searched at a given depth
+static int lmr_reduction(int depth, int move_number) {
+    struct Table {
+        int8_t values[64][64];
+        Table() {
+            for (int d = 0; d < 64; ++d) {
+                for (int n = 0; n < 64; ++n) {
+                    values[d][n] = (d && n) ? static_cast<int8_t>(0.75 + std::log(d) * std::log(n) / 2.25) : 0;
                 }
             }
         }
-        unmake_move(move, piece, captured);
-    }
-    return maximizing_player ? alpha : beta;
+    };
+    static const Table table;
+    return table.values[std::min(depth, 63)][std::min(move_number, 63)];
 }
 
+int CyrusEngine::negamax(int depth, int ply, int alpha, int beta, bool allow_null) {
+    if ((++stats.nodes & 1023) == 0 && stop_flag) _check_limits();
+    if (_stopped()) return 0; // Unwinding an abandoned search; the result is discarded
 
-void CyrusEngine::make_move(const Move& move) {
-    int sr = move.from / 8, sc = move.from % 8;
-    int er = move.to / 8, ec = move.to % 8;
-    char piece = board[sr][sc];
-    char target = board[er][ec];
-
-    // Update hash: xor out pieces from their squares
-    current_hash ^= piece_keys[piece_map(piece)][sr * 8 + sc];
-    if (target != '.') {
-        current_hash ^= piece_keys[piece_map(target)][er * 8 + ec];
-    }
-    
-    board[sr][sc] = '.';
-    // Promotion (to Ferz/Counselor)
-    if (tolower(piece) == 'p' && (er == 0 || er == 7)) {
-        char promo_piece = (current_turn == 'w') ? 'Q' : 'q';
-        board[er][ec] = promo_piece;
-        current_hash ^= piece_keys[piece_map(promo_piece)][er * 8 + ec];
-    } else {
-        board[er][ec] = piece;
-        current_hash ^= piece_keys[piece_map(piece)][er * 8 + ec];
+    // Scores from the tables are exact, so nothing needs searching or storing
+    if (tablebases && ply > 0 && popcount(position.board().occupied) <= TablebaseMaterial::MAX_PIECES) {
+        TablebaseResult result;
+        if (tablebases->probe(position.board(), position.side_to_move(), result)) {
+            ++stats.tb_hits;
+            return _tablebase_score(result);
+        }
+    }
+
+    bool pv_node = beta - alpha > 1;
+    uint64_t hash_key = position.hash();
+    TT_Entry entry;
+    bool tt_hit = transposition_table->probe(hash_key, entry);
+    ++stats.tt_probes;
+    if (tt_hit) ++stats.tt_hits;
+    if (tt_hit) entry.score = _score_from_tt(entry.score, ply);
+    if (tt_hit && entry.depth >= depth) {
+        if (entry.flag == TT_EXACT
+            || (entry.flag == TT_LOWER && entry.score >= beta)
+            || (entry.flag == TT_UPPER && entry.score <= alpha)) {
+            ++stats.tt_cutoffs;
+            return entry.score;
+        }
+    }
+
+    if (depth <= 0) {
+        return quiescence_search(alpha, beta);
+    }
+
+    char turn = current_turn();
+    bool in_check = is_in_check(turn);
+
+    // Null move: if passing still fails high, a real move would too. Passing is
+    // unsound in zugzwang, common in Shatranj endings where the pieces are weak,
+    // so the side to move needs real material and deep searches are verified.
+    if (features.null_move && allow_null && !pv_node && !in_check && depth >= 3
+        && !is_mate_score(beta) && _has_null_move_material(color_index(turn))) {
+        int static_eval = turn == 'w' ? evaluate_board() : -evaluate_board();
+        if (static_eval >= beta) {
+            int reduction = depth >= 7 ? 3 : 2;
+            ply_moves[ply] = {-1, -1};
+            position.make_null_move();
+            int score = -negamax(depth - 1 - reduction, ply + 1, -beta, -beta + 1, false);
+            position.unmake_null_move();
+            if (_stopped()) return 0;
+            if (score >= beta) {
+                if (depth < NULL_MOVE_VERIFY_DEPTH) return is_mate_score(score) ? beta : score;
+                score = negamax(depth - 1 - reduction, ply, beta - 1, beta, false);
+                if (score >= beta) return score;
+            }
+        }
     }
-    
-    current_hash ^= turn_key;
-    current_turn = (current_turn == 'w') ? 'b' : 'w';
+
+    MovePicker picker(*this, turn, tt_hit ? entry.move : 0, ply);
+    Move move;
+    Move best_move = {-1, -1};
+    int original_alpha = alpha;
+    int best_eval = -INFINITE_SCORE;
+    int searched = 0;
+    Move quiets_tried[64];
+    int quiet_count = 0;
+
+    while (picker.next(move)) {
+        int piece = position.piece_on(move.from);
+        int captured = position.piece_on(move.to);
+        bool quiet = captured == NO_PIECE && !(piece_type(piece) == PAWN && (move.to < 8 || move.to >= 56));
+        ply_moves[ply] = move;
+        position.make_move(move);
+        ++searched;
+        int eval;
+        if (searched == 1) {
+            eval = -negamax(depth - 1, ply + 1, -beta, -alpha, true);
+        } else {
+            // Late quiet moves are searched shallower first; any that beat alpha get the full depth.
+            int reduction = 0;
+            if (features.lmr && quiet && depth >= 3 && searched > 3 && !in_check && !is_in_check(current_turn())) {
+                reduction = std::min(lmr_reduction(depth, searched) - pv_node, depth - 2);
+                reduction = std::max(reduction, 0);
+            }
+            int window = features.pvs ? -alpha - 1 : -beta;
+            eval = -negamax(depth - 1 - reduction, ply + 1, window, -alpha, true);
+            if (reduction && eval > alpha) eval = -negamax(depth - 1, ply + 1, window, -alpha, true);
+            if (features.pvs && eval > alpha && eval < beta) eval = -negamax(depth - 1, ply + 1, -beta, -alpha, true);
+        }
+        position.unmake_move();
+        if (eval > best_eval) {
+            best_eval = eval;
+            best_move = move;
+        }
+        if (eval > alpha) alpha = eval;
+        if (alpha >= beta) {
+            _count_cutoff(searched);
+            if (quiet && !_stopped()) _update_quiet_stats(move, ply, depth, quiets_tried, quiet_count);
+            break;
+        }
+        if (quiet && quiet_count < 64) quiets_tried[quiet_count++] = move;
+    }
+    if (best_move.from == -1) return in_check ? -MATE_SCORE + ply : 0; // No legal moves; nearer mates score higher
+    ++stats.interior_nodes;
+    stats.moves_searched += searched;
+    if (_stopped()) return 0;
+    TT_Flag flag = TT_EXACT;
+    if (best_eval <= original_alpha) flag = TT_UPPER;
+    else if (best_eval >= beta) flag = TT_LOWER;
+    transposition_table->store(hash_key, depth, _score_to_tt(best_eval, ply), flag, pack_move(best_move));
+    return best_eval;
 }
 
-void CyrusEngine::unmake_move(const Move& move, char piece, char captured_piece) {
-    int sr = move.from / 8, sc = move.from % 8;
-    int er = move.to / 8, ec = move.to % 8;
+int CyrusEngine::quiescence_search(int alpha, int beta) {
+    if ((++stats.qnodes & 1023) == 0 && stop_flag) _check_limits();
+    char turn = current_turn();
+    int stand_pat = turn == 'w' ? evaluate_board() : -evaluate_board();
+    if (stand_pat >= beta) return beta;
+    alpha = std::max(alpha, stand_pat);
+
+    // Delta pruning: no capture can make up more than a Rukh plus the margin
+    if (features.delta_pruning && stand_pat + PIECE_VALUES[RUKH] + DELTA_MARGIN <= alpha) return alpha;
+
+    MovePicker picker(*this, turn);
+    Move move;
+    while (picker.next(move)) {
+        int captured = position.piece_on(move.to);
+        if (features.delta_pruning && stand_pat + PIECE_VALUES[piece_type(captured)] + DELTA_MARGIN <= alpha) continue;
+        position.make_move(move);
+        int score = -quiescence_search(-beta, -alpha);
+        position.unmake_move();
+        if (score >= beta) return beta;
+        alpha = std::max(alpha, score);
+    }
+    return alpha;
+}
+
+bool CyrusEngine::_has_null_move_material(int color) const {
+    // A Rukh, or two of the minor pieces, to make zugzwang unlikely
+    if (position.board().of(RUKH, color)) return true;
+    return popcount(position.board().of(FARAS, color) | position.board().of(FIL, color) | position.board().of(FERZ, color)) >= 2;
+}
+
+
+void CyrusEngine::make_move(const Move& move) {
+    position.play(move);
+}
 
-    current_turn = (current_turn == 'w') ? 'b' : 'w';
-    current_hash ^= turn_key;
-    
-    char moved_piece = board[er][ec]; // Might be a promoted piece
-    
-    board[sr][sc] = piece; // Restore the original piece
-    board[er][ec] = captured_piece;
-    
-    // Reverse hash updates
-    current_hash ^= piece_keys[piece_map(piece)][sr * 8 + sc];
-    current_hash ^= piece_keys[piece_map(moved_piece)][er * 8 + ec];
-    if (captured_piece != '.') {
-        current_hash ^= piece_keys[piece_map(captured_piece)][er * 8 + ec];
+int CyrusEngine::evaluate_board() {
+    if (network) {
+        int score = _evaluate_network();
+        return position.side_to_move() == WHITE ? score : -score;
     }
+#ifdef CYRUS_DEBUG_EVAL
+    assert(position.eval() == evaluate_pieces(position.board()) && "incremental evaluation out of sync");
+#endif
+    return position.eval();
 }
 
+int CyrusEngine::_evaluate_network() {
+    if (accumulated_by != network.get()) {
+        accumulators.assign(Position::MAX_PLY + 1, NnueNetwork::Accumulator());
+        accumulated_by = network.get();
+    }
+    // Undo entry q holds the hash of the position at ply q and the move made from it
+    int ply = position.ply();
+    auto hash_at = [this, ply](int q) { return q == ply ? position.hash() : position.undo_entry(q).hash; };
+    int base = ply;
+    while (base >= 0 && ply - base <= NNUE_MAX_UPDATES && accumulators[base].hash != hash_at(base)) --base;
 
-int CyrusEngine::evaluate_board() const {
-    int score = 0;
-    for (int r = 0; r < 8; ++r) {
-        for (int c = 0; c < 8; ++c) {
-            char piece = board[r][c];
-            if (piece != '.') {
-                char p_type = tolower(piece);
-                int val = piece_values.at(p_type);
-                int pst_val = (get_piece_color(piece) == 'w') ? pst.at(p_type)[r][c] : pst.at(p_type)[7 - r][c];
-                score += (get_piece_color(piece) == 'w') ? (val + pst_val) : -(val + pst_val);
+    if (base < 0 || ply - base > NNUE_MAX_UPDATES) {
+        network->refresh(position.board(), accumulators[ply]);
+    } else {
+        for (int q = base; q < ply; ++q) {
+            const Position::Undo& undo = position.undo_entry(q);
+            if (undo.piece == NO_PIECE) { // Null move
+                accumulators[q + 1] = accumulators[q];
+            } else {
+                Move move = unpack_move(undo.move);
+                int row = move.to / 8;
+                int placed = undo.piece;
+                if (piece_type(placed) == PAWN && (row == 0 || row == 7)) placed = make_piece(FERZ, piece_color(placed));
+                NnueNetwork::Feature removed[2] = {{undo.piece, move.from}, {undo.captured, move.to}};
+                NnueNetwork::Feature added[1] = {{placed, move.to}};
+                network->update(accumulators[q], accumulators[q + 1], removed, undo.captured == NO_PIECE ? 1 : 2, added, 1);
             }
+            accumulators[q + 1].hash = hash_at(q + 1);
         }
     }
-    return score;
+    accumulators[ply].hash = position.hash();
+#ifdef CYRUS_DEBUG_EVAL
+    NnueNetwork::Accumulator full;
+    network->refresh(position.board(), full);
+    assert(std::memcmp(full.values, accumulators[ply].values, sizeof(full.values)) == 0 && "accumulator out of sync");
+#endif
+    return network->evaluate(accumulators[ply], position.side_to_move());
 }
 
 std::vector<Move> CyrusEngine::get_all_legal_moves(char turn, bool sort) {
-    auto pseudo_moves = _generate_pseudo_legal_moves(turn, false);
-    std::vector<Move> legal_moves;
-    for (const auto& move : pseudo_moves) {
-        char piece = board[move.from / 8][move.from % 8];
-        char captured = board[move.to / 8][move.to % 8];
-        make_move(move);
-        // We check the color that just moved
-        if (!is_in_check( (turn == 'w' ? 'b' : 'w') )) {
-            legal_moves.push_back(move);
-        }
-        unmake_move(move, piece, captured);
-    }
+    MoveList moves;
+    _generate_moves(turn, GEN_ALL, moves);
     if (sort) {
-        std::sort(legal_moves.begin(), legal_moves.end(), [this](const Move& a, const Move& b) {
-            return _score_move(a) > _score_move(b);
+        // Score each move once, then sort by the stored scores
+        for (int i = 0; i < moves.size(); ++i) moves.scores[i] = _score_move(moves[i], 0);
+        int order[MAX_MOVES];
+        for (int i = 0; i < moves.size(); ++i) order[i] = i;
+        std::stable_sort(order, order + moves.size(), [&moves](int a, int b) {
+            return moves.scores[a] > moves.scores[b];
         });
+        std::vector<Move> sorted;
+        sorted.reserve(moves.size());
+        for (int i = 0; i < moves.size(); ++i) sorted.push_back(moves[order[i]]);
+        return sorted;
     }
-    return legal_moves;
+    return std::vector<Move>(moves.begin(), moves.end());
 }
 
 
-int CyrusEngine::_score_move(const Move& move) const {
-    char target = board[move.to / 8][move.to % 8];
-    if (target != '.') {
-        char attacker = board[move.from/8][move.from%8];
+uint64_t CyrusEngine::perft(int depth) {
+    if (depth == 0) return 1;
+    MoveList moves;
+    _generate_moves(current_turn(), GEN_ALL, moves);
+    if (depth == 1) return moves.size(); // Bulk count the leaves
+    uint64_t nodes = 0;
+    for (const auto& move : moves) {
+        position.make_move(move);
+        nodes += perft(depth - 1);
+        position.unmake_move();
+    }
+    return nodes;
+}
+
+std::vector<std::pair<Move, uint64_t>> CyrusEngine::divide(int depth) {
+    std::vector<std::pair<Move, uint64_t>> result;
+    if (depth < 1) return result;
+    MoveList moves;
+    _generate_moves(current_turn(), GEN_ALL, moves);
+    for (const auto& move : moves) {
+        position.make_move(move);
+        result.push_back({move, perft(depth - 1)});
+        position.unmake_move();
+    }
+    return result;
+}
+
+int CyrusEngine::_score_move(const Move& move, int ply) const {
+    int target = position.piece_on(move.to);
+    if (target != NO_PIECE) {
+        int attacker = position.piece_on(move.from);
         // MVV-LVA (Most Valuable Victim - Least Valuable Aggressor)
-        return 10 * piece_values.at(tolower(target)) - piece_values.at(tolower(attacker));
+        return CAPTURE_SCORE + 10 * PIECE_VALUES[piece_type(target)] - PIECE_VALUES[piece_type(attacker)];
     }
-    return 0;
+    return _score_quiet(move, ply);
 }
 
-std::vector<Move> CyrusEngine::_generate_pseudo_legal_moves(char color, bool captures_only) const {
-    std::vector<Move> moves;
-    for (int r = 0; r < 8; ++r) {
-        for (int c = 0; c < 8; ++c) {
-            if (board[r][c] != '.' && get_piece_color(board[r][c]) == color) {
-                _get_moves_for_piece(r, c, moves);
+int CyrusEngine::see(const Move& move) const {
+    // Cheapest first; the Ferz is worth barely more than a pawn in Shatranj
+    static const int ATTACKER_ORDER[6] = {PAWN, FERZ, FIL, FARAS, RUKH, SHAH};
+
+    int to = move.to;
+    int target = position.piece_on(to);
+    int gain[32];
+    int d = 0;
+    gain[0] = target == NO_PIECE ? 0 : PIECE_VALUES[piece_type(target)];
+    int on_square = piece_type(position.piece_on(move.from)); // Type of the piece standing on `to`
+    int side = piece_color(position.piece_on(move.from)) ^ 1;
+    uint64_t occupied = position.board().occupied ^ square_bb(move.from);
+    uint64_t rukhs = position.board().of(RUKH, WHITE) | position.board().of(RUKH, BLACK);
+    uint64_t attackers = attacks::attackers_to(position.board(), to, occupied) & occupied;
+
+    while (d < 31) {
+        uint64_t ours = attackers & position.board().occupancy[side];
+        if (!ours) break;
+        int type = SHAH;
+        uint64_t from_bb = 0;
+        for (int t : ATTACKER_ORDER) {
+            from_bb = ours & position.board().of(t, side);
+            if (from_bb) {
+                type = t;
+                break;
             }
         }
+        from_bb = square_bb(lsb(from_bb));
+        // The Shah may only recapture if nothing defends the square any more
+        if (type == SHAH && (attackers & ~from_bb & position.board().occupancy[side ^ 1])) break;
+
+        ++d;
+        gain[d] = PIECE_VALUES[on_square] - gain[d - 1];
+        if (std::max(-gain[d - 1], gain[d]) < 0) break; // Neither side can gain by continuing
+        occupied ^= from_bb;
+        // Only a Rukh can be uncovered behind the piece that just left
+        attackers = (attackers | (attacks::rukh_attacks(to, occupied) & rukhs)) & occupied;
+        on_square = type;
+        side ^= 1;
+    }
+    for (; d > 0; --d) gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+    return gain[0];
+}
+
+int CyrusEngine::_score_quiet(const Move& move, int ply) const {
+    if (features.killers) {
+        if (move == killers[ply][0]) return KILLER_SCORE;
+        if (move == killers[ply][1]) return KILLER_SCORE - 1;
     }
-    if (captures_only) {
-        std::vector<Move> capture_moves;
-        for (const auto& move : moves) {
-            if (board[move.to / 8][move.to % 8] != '.') {
-                capture_moves.push_back(move);
-            }
-        }
-        return capture_moves;
+    if (features.countermoves && move == _countermove(ply)) return COUNTERMOVE_SCORE;
+    if (!features.history) return 0;
+    return history[piece_color(position.piece_on(move.from))][move.from][move.to];
+}
+
+Move CyrusEngine::_countermove(int ply) const {
+    if (ply == 0 || ply_moves[ply - 1].from == -1) return {-1, -1};
+    const Move& previous = ply_moves[ply - 1];
+    return countermoves[position.piece_on(previous.to)][previous.to];
+}
+
+void CyrusEngine::_update_quiet_stats(const Move& move, int ply, int depth, const Move* quiets_tried, int quiet_count) {
+    if (killers[ply][0] != move) {
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = move;
+    }
+    if (ply > 0 && ply_moves[ply - 1].from != -1) {
+        const Move& previous = ply_moves[ply - 1];
+        countermoves[position.piece_on(previous.to)][previous.to] = move;
     }
-    return moves;
+
+    // Reward the cutoff move and penalize the quiets searched before it. The
+    // update shrinks as an entry nears MAX_HISTORY, keeping scores bounded.
+    int color = piece_color(position.piece_on(move.from));
+    int bonus = std::min(depth * depth, 400);
+    auto update = [&](const Move& m, int delta) {
+        int& entry = history[color][m.from][m.to];
+        entry += delta - entry * std::abs(delta) / MAX_HISTORY;
+    };
+    update(move, bonus);
+    for (int i = 0; i < quiet_count; ++i) update(quiets_tried[i], -bonus);
 }
 
-void CyrusEngine::_get_moves_for_piece(int r, int c, std::vector<Move>& moves) const {
-    char piece = tolower(board[r][c]);
-    char color = get_piece_color(board[r][c]);
-    switch (piece) {
-        case 'p': _get_pawn_moves(r, c, color, moves); break;
-        case 'n': _get_faras_moves(r, c, color, moves); break;
-        case 'b': _get_fil_moves(r, c, color, moves); break;
-        case 'r': _get_sliding_moves(r, c, color, {{1,0},{-1,0},{0,1},{0,-1}}, moves); break;
-        case 'q': _get_ferz_moves(r, c, color, moves); break;
-        case 'k': _get_shah_moves(r, c, color, moves); break;
+void CyrusEngine::_clear_move_ordering() {
+    for (auto& pair : killers) pair[0] = pair[1] = {-1, -1};
+    for (auto& by_color : history) for (auto& by_from : by_color) for (int& h : by_from) h = 0;
+    for (auto& by_piece : countermoves) for (Move& m : by_piece) m = {-1, -1};
+}
+
+void CyrusEngine::_age_move_ordering() {
+    // Killers belong to the old position's plies; history and countermoves still say something
+    for (auto& pair : killers) pair[0] = pair[1] = {-1, -1};
+    for (auto& by_color : history) for (auto& by_from : by_color) for (int& h : by_from) h /= 2;
+}
+
+// All generators append to `moves`.
+void CyrusEngine::_generate_moves(char color, GenType type, MoveList& moves) {
+    if (use_legal_movegen) {
+        _generate_legal_moves(color, type, moves);
+    } else {
+        _filter_pseudo_legal_moves(color, type, moves);
     }
 }
 
-void CyrusEngine::_get_pawn_moves(int r, int c, char color, std::vector<Move>& moves) const {
-    int dir = (color == 'w') ? -1 : 1;
-    if (r + dir >= 0 && r + dir < 8) {
-        if (board[r + dir][c] == '.') {
-            moves.push_back({r * 8 + c, (r + dir) * 8 + c});
-        }
-        for (int dc : {-1, 1}) {
-            if (c + dc >= 0 && c + dc < 8 && board[r + dir][c + dc] != '.' && get_piece_color(board[r + dir][c + dc]) != color) {
-                moves.push_back({r * 8 + c, (r + dir) * 8 + (c + dc)});
-            }
-        }
+uint64_t CyrusEngine::_gen_targets(int color, GenType type) const {
+    switch (type) {
+        case GEN_CAPTURES: return position.board().occupancy[color ^ 1];
+        case GEN_QUIETS: return ~position.board().occupied;
+        default: return ~position.board().occupancy[color];
     }
 }
 
-void CyrusEngine::_get_faras_moves(int r, int c, char color, std::vector<Move>& moves) const { // Knight
-    std::vector<std::pair<int, int>> deltas = {{1,2},{1,-2},{-1,2},{-1,-2},{2,1},{2,-1},{-2,1},{-2,-1}};
-    for (auto d : deltas) {
-        int nr = r + d.first, nc = c + d.second;
-        if (nr >= 0 && nr < 8 && nc >= 0 && nc < 8 && get_piece_color(board[nr][nc]) != color) {
-            moves.push_back({r * 8 + c, nr * 8 + nc});
+void CyrusEngine::_filter_pseudo_legal_moves(char color, GenType type, MoveList& moves) {
+    MoveList pseudo_moves;
+    _generate_pseudo_legal_moves(color, type, pseudo_moves);
+    for (const auto& move : pseudo_moves) {
+        position.make_move(move);
+        // We check the color that just moved
+        if (!is_in_check(color)) {
+            moves.push_back(move);
         }
+        position.unmake_move();
     }
 }
 
-void CyrusEngine::_get_fil_moves(int r, int c, char color, std::vector<Move>& moves) const { // Elephant
-    std::vector<std::pair<int, int>> deltas = {{2,2},{2,-2},{-2,2},{-2,-2}};
-    for (auto d : deltas) {
-        int nr = r + d.first, nc = c + d.second;
-        if (nr >= 0 && nr < 8 && nc >= 0 && nc < 8 && get_piece_color(board[nr][nc]) != color) {
-            moves.push_back({r * 8 + c, nr * 8 + nc});
+void CyrusEngine::_generate_legal_moves(char color, GenType type, MoveList& moves) const {
+    int us = color_index(color), them = us ^ 1;
+    uint64_t own = position.board().occupancy[us], enemy = position.board().occupancy[them];
+    uint64_t king = position.board().of(SHAH, us);
+    if (!king) return; // A missing king counts as being in check, so nothing is legal
+    int king_sq = lsb(king);
+    uint64_t allowed = _gen_targets(us, type);
+
+    // King moves: the destination must not be attacked once the king has left its square,
+    // so rook rays that run through the king's current square are seen.
+    uint64_t occupied_without_king = position.board().occupied ^ king;
+    uint64_t king_targets = attacks::SHAH_ATTACKS[king_sq] & allowed;
+    while (king_targets) {
+        int to = pop_lsb(king_targets);
+        if (!(attacks::attackers_to(position.board(), to, occupied_without_king) & enemy)) {
+            moves.push_back({king_sq, to});
         }
     }
+
+    uint64_t checkers = attacks::attackers_to(position.board(), king_sq, position.board().occupied) & enemy;
+    if (popcount(checkers) > 1) return; // Double check: only the king may move
+
+    // With a single checker, other pieces must capture it or step between it and the king
+    uint64_t check_mask = checkers ? checkers | attacks::BETWEEN[king_sq][lsb(checkers)] : ~0ULL;
+    uint64_t targets = allowed & check_mask;
+
+    // Only the Rukh slides, so only enemy rooks on the king's rank or file can pin
+    uint64_t pinned = 0;
+    uint64_t snipers = attacks::rukh_attacks(king_sq, 0) & position.board().of(RUKH, them);
+    while (snipers) {
+        uint64_t blockers = attacks::BETWEEN[king_sq][pop_lsb(snipers)] & position.board().occupied;
+        if (popcount(blockers) == 1) pinned |= blockers & own;
+    }
+
+    int first = moves.size();
+    _get_pawn_moves(us, targets, moves);
+    _get_faras_moves(us, targets, moves);
+    _get_fil_moves(us, targets, moves);
+    _get_rukh_moves(us, targets, moves);
+    _get_ferz_moves(us, targets, moves);
+    if (pinned) {
+        // A pinned piece may only move along the line through its king and the pinner
+        Move* end = std::remove_if(moves.begin() + first, moves.end(), [&](const Move& move) {
+            return (pinned & square_bb(move.from)) && !(attacks::LINE[king_sq][move.from] & square_bb(move.to));
+        });
+        moves.count = static_cast<int>(end - moves.begin());
+    }
 }
 
-void CyrusEngine::_get_ferz_moves(int r, int c, char color, std::vector<Move>& moves) const { // Counselor
-    std::vector<std::pair<int, int>> deltas = {{1,1},{1,-1},{-1,1},{-1,-1}};
-    for (auto d : deltas) {
-        int nr = r + d.first, nc = c + d.second;
-        if (nr >= 0 && nr < 8 && nc >= 0 && nc < 8 && get_piece_color(board[nr][nc]) != color) {
-            moves.push_back({r * 8 + c, nr * 8 + nc});
-        }
+void CyrusEngine::_generate_pseudo_legal_moves(char color, GenType type, MoveList& moves) const {
+    int us = color_index(color);
+    uint64_t targets = _gen_targets(us, type);
+    _get_pawn_moves(us, targets, moves);
+    _get_faras_moves(us, targets, moves);
+    _get_fil_moves(us, targets, moves);
+    _get_rukh_moves(us, targets, moves);
+    _get_ferz_moves(us, targets, moves);
+    _get_shah_moves(us, targets, moves);
+}
+
+bool CyrusEngine::_is_legal(const Move& move, char color) {
+    if (move.from < 0 || move.from > 63 || move.to < 0 || move.to > 63) return false;
+    int us = color_index(color);
+    int piece = position.piece_on(move.from);
+    int target = position.piece_on(move.to);
+    if (piece == NO_PIECE || piece_color(piece) != us) return false;
+    if (target != NO_PIECE && piece_color(target) == us) return false;
+
+    uint64_t to_bb = square_bb(move.to);
+    bool reachable = false;
+    switch (piece_type(piece)) {
+        case PAWN:
+            reachable = target == NO_PIECE ? move.to == move.from + (us == WHITE ? -8 : 8)
+                                           : (attacks::PAWN_ATTACKS[us][move.from] & to_bb) != 0;
+            break;
+        case FARAS: reachable = attacks::FARAS_ATTACKS[move.from] & to_bb; break;
+        case FIL: reachable = attacks::FIL_ATTACKS[move.from] & to_bb; break;
+        case RUKH: reachable = attacks::rukh_attacks(move.from, position.board().occupied) & to_bb; break;
+        case FERZ: reachable = attacks::FERZ_ATTACKS[move.from] & to_bb; break;
+        case SHAH: reachable = attacks::SHAH_ATTACKS[move.from] & to_bb; break;
+    }
+    if (!reachable) return false;
+
+    position.make_move(move);
+    bool legal = !is_in_check(color);
+    position.unmake_move();
+    return legal;
+}
+
+void CyrusEngine::_add_moves(int from, uint64_t to_squares, MoveList& moves) const {
+    while (to_squares) {
+        moves.push_back({from, pop_lsb(to_squares)});
     }
 }
 
-void CyrusEngine::_get_shah_moves(int r, int c, char color, std::vector<Move>& moves) const { // King
-    std::vector<std::pair<int, int>> deltas = {{1,0},{-1,0},{0,1},{0,-1},{1,1},{1,-1},{-1,1},{-1,-1}};
-    for (auto d : deltas) {
-        int nr = r + d.first, nc = c + d.second;
-        if (nr >= 0 && nr < 8 && nc >= 0 && nc < 8 && get_piece_color(board[nr][nc]) != color) {
-            moves.push_back({r * 8 + c, nr * 8 + nc});
+void CyrusEngine::_get_pawn_moves(int color, uint64_t targets, MoveList& moves) const {
+    int dir = (color == WHITE) ? -8 : 8;
+    uint64_t pawns = position.board().of(PAWN, color);
+    while (pawns) {
+        int sq = pop_lsb(pawns);
+        int ahead = sq + dir;
+        if (ahead >= 0 && ahead < 64 && !(position.board().occupied & square_bb(ahead))) {
+            _add_moves(sq, square_bb(ahead) & targets, moves);
         }
+        _add_moves(sq, attacks::PAWN_ATTACKS[color][sq] & position.board().occupancy[color ^ 1] & targets, moves);
     }
 }
 
-void CyrusEngine::_get_sliding_moves(int r, int c, char color, const std::vector<std::pair<int, int>>& deltas, std::vector<Move>& moves) const {
-    for (auto d : deltas) {
-        int nr = r + d.first, nc = c + d.second;
-        while (nr >= 0 && nr < 8 && nc >= 0 && nc < 8) {
-            if (board[nr][nc] == '.') {
-                moves.push_back({r * 8 + c, nr * 8 + nc});
-            } else {
-                if (get_piece_color(board[nr][nc]) != color) {
-                    moves.push_back({r * 8 + c, nr * 8 + nc});
-                }
-                break;
-            }
-            nr += d.first; nc += d.second;
-        }
+void CyrusEngine::_get_faras_moves(int color, uint64_t targets, MoveList& moves) const { // Knight
+    uint64_t b = position.board().of(FARAS, color);
+    while (b) {
+        int sq = pop_lsb(b);
+        _add_moves(sq, attacks::FARAS_ATTACKS[sq] & targets, moves);
     }
 }
 
-bool CyrusEngine::is_in_check(char color) const {
-    auto king_pos = find_king(color);
-    if (king_pos.first == -1) return true; // King not found, which is a game-ending state
-
-    char opponent = (color == 'w') ? 'b' : 'w';
-    auto opponent_moves = _generate_pseudo_legal_moves(opponent, false);
-    
-    int king_square = king_pos.first * 8 + king_pos.second;
-    for (const auto& move : opponent_moves) {
-        if (move.to == king_square) {
-            return true;
-        }
+void CyrusEngine::_get_fil_moves(int color, uint64_t targets, MoveList& moves) const { // Elephant
+    uint64_t b = position.board().of(FIL, color);
+    while (b) {
+        int sq = pop_lsb(b);
+        _add_moves(sq, attacks::FIL_ATTACKS[sq] & targets, moves);
     }
-    return false;
 }
 
-std::pair<int, int> CyrusEngine::find_king(char color) const {
-    char king_char = (color == 'w') ? 'K' : 'k';
-    for (int r = 0; r < 8; ++r) {
-        for (int c = 0; c < 8; ++c) {
-            if (board[r][c] == king_char) {
-                return {r, c};
-            }
-        }
+void CyrusEngine::_get_ferz_moves(int color, uint64_t targets, MoveList& moves) const { // Counselor
+    uint64_t b = position.board().of(FERZ, color);
+    while (b) {
+        int sq = pop_lsb(b);
+        _add_moves(sq, attacks::FERZ_ATTACKS[sq] & targets, moves);
     }
-    return {-1, -1}; // Should not happen in a normal game
+}
+
+void CyrusEngine::_get_shah_moves(int color, uint64_t targets, MoveList& moves) const { // King
+    uint64_t b = position.board().of(SHAH, color);
+    while (b) {
+        int sq = pop_lsb(b);
+        _add_moves(sq, attacks::SHAH_ATTACKS[sq] & targets, moves);
+    }
+}
+
+void CyrusEngine::_get_rukh_moves(int color, uint64_t targets, MoveList& moves) const { // Rook
+    uint64_t b = position.board().of(RUKH, color);
+    while (b) {
+        int sq = pop_lsb(b);
+        _add_moves(sq, attacks::rukh_attacks(sq, position.board().occupied) & targets, moves);
+    }
+}
+
+bool CyrusEngine::is_in_check(char color) const {
+    return position.in_check(color_index(color));
+}
+
+bool CyrusEngine::is_square_attacked(int square, char by_color) const {
+    return position.attacked(square, color_index(by_color));
+}
+
+int CyrusEngine::find_king(char color) const {
+    uint64_t king = position.board().of(SHAH, color_index(color));
+    return king ? lsb(king) : -1; // -1 should not happen in a normal game
 }
 
 bool CyrusEngine::is_game_over(char turn) {
-    return get_all_legal_moves(turn, false).empty();
+    return popcount(position.board().occupied) == 2 || get_all_legal_moves(turn, false).empty();
 }
 
 std::string CyrusEngine::get_game_over_message(char turn) {
+    if (popcount(position.board().occupied) == 2) return "Bare kings: the game is drawn.";
     std::string winner = (turn == 'w') ? "Black" : "White";
     if (is_in_check(turn)) {
         return "Checkmate! " + winner + " wins.";
     } else {
-        return "Stalemate! " + winner + " wins.";
+        return "Stalemate: the game is drawn.";
     }
 }
\ No newline at end of file
@@ -4,81 +4,265 @@
 #include <vector>
 #include <string>
 #include <cstdint>
-#include <unordered_map>
+#include <cstdlib>
 #include <chrono>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <iosfwd>
+#include "Bitboard.h"
+#include "TranspositionTable.h"
+#include "Move.h"
+#include "SearchStats.h"
+#include "OpeningBook.h"
+#include "Tablebase.h"
+#include "Position.h"
+#include "Nnue.h"
 
-// Represents a single move (from square 0-63, to square 0-63)
-struct Move {
-    int from;
-    int to;
-    char promotion = ' '; // For potential future use, not in Shatranj
+// Formats a move in coordinate notation, e.g. "e2e4"
+std::string format_move(const Move& move);
 
-    bool operator==(const Move& other) const {
-        return from == other.from && to == other.to;
-    }
+constexpr const char* START_FEN = "rnbkqbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBKQBNR w - - 0 1";
+
+// Limits for one find_best_move call. Zero means "no limit"; with no limits at
+// all the search goes to SEARCH_DEPTH.
+struct SearchLimits {
+    int depth = 0;              // Deepest iteration to run
+    int64_t soft_time_ms = 0;   // Start no new iteration once this much time has passed
+    int64_t hard_time_ms = 0;   // Abort the running iteration at this point
+    uint64_t nodes = 0;         // Abort once this many nodes have been searched
+    bool stop_on_mate = true;   // Stop deepening once an iteration proves a forced mate
+    bool infinite = false;      // Deepen to MAX_DEPTH unless another limit applies
+
+    // Set by another thread to end the search early; the last completed
+    // iteration's move is returned.
+    const std::atomic<bool>* stop = nullptr;
+    // Pondering: while this is true the time and node limits are ignored. Once
+    // another thread clears it (ponderhit) they apply, timed from that moment.
+    const std::atomic<bool>* ponder = nullptr;
 };
 
-// For the transposition table
-enum TT_Flag { TT_EXACT, TT_LOWER, TT_UPPER };
-struct TT_Entry {
-    int depth;
-    int score;
-    TT_Flag flag;
+// Reported after every completed iteration of the main search thread
+struct SearchInfo {
+    int depth = 0;
+    int score = 0;         // Side to move's view
+    uint64_t nodes = 0;    // All threads; helpers are counted in steps of 1024
+    double time_ms = 0;
+    int hashfull = 0;      // Permille
+    std::vector<Move> pv;  // Starts with the best move
 };
 
+// Search techniques, each switchable for benchmarking. All off gives plain
+// fail-soft alpha-beta.
+struct SearchFeatures {
+    bool pvs = true;         // Null-window searches after the first move, re-searched on fail high
+    bool aspiration = true;  // Root window around the previous iteration's score
+    bool null_move = true;   // Null-move pruning, guarded against zugzwang
+    bool lmr = true;         // Late move reductions for quiet moves
+    bool killers = true;     // Two quiet cutoff moves remembered per ply
+    bool history = true;     // Butterfly history of quiet cutoffs, [color][from][to]
+    bool countermoves = true; // Quiet reply that refuted the previous move
+    bool see = true;         // Losing captures ordered after quiets, and skipped in quiescence
+    bool delta_pruning = true; // Quiescence skips captures that cannot lift the score to alpha
+};
+
+// Which moves a generator call produces
+enum GenType { GEN_CAPTURES, GEN_QUIETS, GEN_ALL };
+
 class CyrusEngine {
+    friend class MovePicker;
+
 public:
     CyrusEngine();
     void print_board() const;
-    Move find_best_move(char turn);
+    Move find_best_move(char turn, const SearchLimits& limits = SearchLimits());
     void make_move(const Move& move);
     std::vector<Move> get_all_legal_moves(char turn, bool sort = false);
     bool is_in_check(char color) const;
-    bool is_game_over(char turn);
+    bool is_square_attacked(int square, char by_color) const;
+    // Static exchange evaluation: material won by `move` once every recapture on
+    // its target square is played out, cheapest attacker first. Ignores pins.
+    int see(const Move& move) const;
+    bool is_game_over(char turn); // No legal move, or bare kings
     std::string get_game_over_message(char turn);
 
     // Board representation and turn
-    std::vector<std::vector<char>> board;
-    char current_turn = 'w';
+    void set_board(const std::vector<std::vector<char>>& layout, char turn);
+    std::vector<std::vector<char>> get_board() const; // Derived char view, '.' for empty
+    char piece_at(int square) const;
+    const Bitboards& get_bitboards() const { return position.board(); }
+    char current_turn() const { return position.side_to_move() == WHITE ? 'w' : 'b'; }
+    // The whole game state, e.g. to hand one position to several engines
+    const Position& get_position() const { return position; }
+    void set_position(const Position& p) { position = p; }
+
+    // Shatranj FEN, e.g. the start position:
+    //   rnbkqbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBKQBNR w - - 0 1
+    // Letters are as in get_board: n = Faras, b = Fil, r = Rukh, q = Ferz, k = Shah.
+    // Castling and en passant fields are always '-'; the move counters are
+    // accepted but not tracked, and written back as "0 1".
+    bool set_fen(const std::string& fen); // False, leaving the position unchanged, if malformed
+    std::string get_fen() const;
+
+    // true: emit only legal moves using check and pin masks computed once per node.
+    // false: filter pseudo-legal moves through make_move/is_in_check, for cross-checking.
+    bool use_legal_movegen = true;
+
+    // Transposition table memory budget, in megabytes (clears the table)
+    void set_hash_size(size_t megabytes) { transposition_table->resize(megabytes); }
+    // The table persists across find_best_move calls, with older entries aged
+    // out first; clear it when starting an unrelated game. A saved table can be
+    // loaded back (memory-mapped, at its saved size) to warm-start a new process.
+    void clear_hash() { transposition_table->clear(); }
+    void new_game() { clear_hash(); _clear_move_ordering(); } // Forget everything learned from earlier searches
+    bool save_hash(const std::string& path) const { return transposition_table->save(path); }
+    bool load_hash(const std::string& path) { return transposition_table->load(path); }
+    // Searches with another table instead of this engine's own, e.g. many
+    // engines playing unrelated games under one memory budget. The caller then
+    // owns the aging: find_best_move no longer calls new_search on it, so the
+    // table must be allocated (one new_search) before the first search.
+    void share_hash(std::shared_ptr<TranspositionTable> table) {
+        transposition_table = std::move(table);
+        owns_hash = false;
+    }
+
+    // Lazy SMP: find_best_move runs this many threads, each on its own copy of the
+    // position, all sharing one lock-free transposition table.
+    int search_threads = 1;
+
+    SearchFeatures features;
+    static const int MATE_SCORE = 99999; // Search score of a forced mate, less the plies to it
+    static bool is_mate_score(int score) { return std::abs(score) >= MATE_SCORE - MAX_DEPTH; }
+
+    // Opening book consulted by find_best_move before it searches; one mapping
+    // can be shared by many engines. With book_random the move is drawn in
+    // proportion to the entry weights, otherwise the heaviest is played.
+    std::shared_ptr<const OpeningBook> book;
+    bool book_random = false;
+    uint64_t hash() const { return position.hash(); } // Zobrist key of the position, as used by the book
+
+    // Endgame tablebases, shared like the book. With at most four pieces left
+    // the search takes exact results from them instead of searching; a won
+    // root position is played straight from the tables, fastest mate first.
+    std::shared_ptr<const Tablebases> tablebases;
+    static const int TABLEBASE_WIN_SCORE = 50000; // Less the distance to mate; below MATE_SCORE
+
+    // Neural evaluation, shared like the book. When set, the search scores
+    // positions with it instead of the material + piece-square tables.
+    std::shared_ptr<const NnueNetwork> network;
+
+    // Counters from the last find_best_move call, all threads merged. When
+    // stats_log is set, each search also writes them to it as one JSON line.
+    const SearchStats& get_search_stats() const { return stats; }
+    std::ostream* stats_log = nullptr;
+    // Called on the searching thread after every completed iteration
+    std::function<void(const SearchInfo&)> on_iteration;
+
+    // --- Perft (move generation testing) ---
+    // Counts leaf nodes of the legal move tree from the current position; divide
+    // reports the count below each root move.
+    uint64_t perft(int depth);
+    std::vector<std::pair<Move, uint64_t>> divide(int depth);
 
 private:
     // --- Internal Logic ---
-    int minimax(int depth, int alpha, int beta, bool maximizing_player);
-    int quiescence_search(int alpha, int beta, bool maximizing_player);
-    int evaluate_board() const;
-    void unmake_move(const Move& move, char piece, char captured_piece);
+    // Negamax search: scores are from the side to move's point of view.
+    int _aspiration_search(int depth, int previous_score, Move& best_move, const Move& first_move);
+    int _search_root(int depth, int alpha, int beta, Move& best_move, const Move& first_move);
+    void _helper_search(int thread_id);
+    bool _stopped() const { return stop_flag && stop_flag->load(std::memory_order_relaxed); }
+    void _check_limits();
+    bool _pondering(); // Also notices the ponderhit and restarts the clock
+    std::vector<Move> _principal_variation(const Move& best_move, int max_length);
+    bool _probe_book(const std::vector<Move>& legal_moves, Move& move) const;
+    bool _probe_tablebase_root(const std::vector<Move>& legal_moves, Move& move, int& score);
+    static int _tablebase_score(const TablebaseResult& result) {
+        return result.wdl * (TABLEBASE_WIN_SCORE - result.dtm);
+    }
+    void _count_cutoff(int move_number) { ++stats.beta_cutoffs; stats.first_move_cutoffs += move_number == 1; }
+    int negamax(int depth, int ply, int alpha, int beta, bool allow_null);
+    int quiescence_search(int alpha, int beta);
+    bool _has_null_move_material(int color) const;
+    int evaluate_board(); // White's view; CYRUS_DEBUG_EVAL checks it against a full recompute
+    int _evaluate_network(); // Side to move's view
+
+    // --- Position ---
+    // Board, side to move, hash and incremental eval with their undo stack.
+    // Search copies (Lazy SMP helpers) each get their own.
+    Position position;
+    // First-layer sums of the network, indexed by Position::ply(). Each is
+    // tagged with its position's hash and brought up to date from the nearest
+    // valid one below it by replaying the undo entries in between.
+    std::vector<NnueNetwork::Accumulator> accumulators;
+    const NnueNetwork* accumulated_by = nullptr; // Network the accumulators hold sums for
 
     // --- Move Generation ---
-    std::vector<Move> _generate_pseudo_legal_moves(char color, bool captures_only) const;
-    void _get_moves_for_piece(int r, int c, std::vector<Move>& moves) const;
-    void _get_pawn_moves(int r, int c, char color, std::vector<Move>& moves) const;
-    void _get_faras_moves(int r, int c, char color, std::vector<Move>& moves) const; // Knight
-    void _get_fil_moves(int r, int c, char color, std::vector<Move>& moves) const;   // Elephant
-    void _get_ferz_moves(int r, int c, char color, std::vector<Move>& moves) const;  // Counselor
-    void _get_shah_moves(int r, int c, char color, std::vector<Move>& moves) const;  // King
-    void _get_sliding_moves(int r, int c, char color, const std::vector<std::pair<int, int>>& deltas, std::vector<Move>& moves) const;
+    // Generators take a color index (WHITE/BLACK) and a mask of allowed target squares.
+    void _generate_moves(char color, GenType type, MoveList& moves);
+    void _generate_legal_moves(char color, GenType type, MoveList& moves) const;
+    void _filter_pseudo_legal_moves(char color, GenType type, MoveList& moves);
+    void _generate_pseudo_legal_moves(char color, GenType type, MoveList& moves) const;
+    uint64_t _gen_targets(int color, GenType type) const;
+    bool _is_legal(const Move& move, char color); // Validates a move from outside the generator, e.g. the TT
+    void _get_pawn_moves(int color, uint64_t targets, MoveList& moves) const;
+    void _get_faras_moves(int color, uint64_t targets, MoveList& moves) const; // Knight
+    void _get_fil_moves(int color, uint64_t targets, MoveList& moves) const;   // Elephant
+    void _get_ferz_moves(int color, uint64_t targets, MoveList& moves) const;  // Counselor
+    void _get_shah_moves(int color, uint64_t targets, MoveList& moves) const;  // King
+    void _get_rukh_moves(int color, uint64_t targets, MoveList& moves) const;  // Rook
+    void _add_moves(int from, uint64_t to_squares, MoveList& moves) const;
 
     // --- Helpers ---
-    char get_piece_color(char p) const;
-    std::pair<int, int> find_king(char color) const;
-    int _score_move(const Move& move) const;
+    static int color_index(char color) { return color == 'w' ? WHITE : BLACK; }
+    int find_king(char color) const; // Square of the king, -1 if missing
+    int _score_move(const Move& move, int ply = 0) const; // Captures above every quiet move
+    int _score_quiet(const Move& move, int ply) const;
 
     // --- AI Configuration ---
-    static const int SEARCH_DEPTH = 4;
+    static const int SEARCH_DEPTH = 4; // Used when find_best_move gets no limits
+    static const int MAX_DEPTH = 64;
+    static const int INFINITE_SCORE = 999999;
+    static const int ASPIRATION_WINDOW = 50;     // Initial half-width, doubled on each fail
+    static const int NULL_MOVE_VERIFY_DEPTH = 8; // From here a null-move cutoff is verified by a reduced search
+    static const int DELTA_MARGIN = 200;         // Positional slack allowed on top of a capture's material
+    static const int NNUE_MAX_UPDATES = 8;       // Moves replayed onto an accumulator before a refresh is cheaper
     std::chrono::steady_clock::time_point search_start_time;
+    std::atomic<bool>* stop_flag = nullptr; // Set during a search; raised to unwind it
+    const std::atomic<bool>* external_stop = nullptr; // SearchLimits::stop, polled by the main thread
+    const std::atomic<bool>* ponder_flag = nullptr;   // SearchLimits::ponder until the ponderhit
+    std::atomic<uint64_t>* node_counter = nullptr;    // Helpers add their nodes here for SearchInfo
+    SearchStats stats;         // This thread's counters for the running search
+    int64_t hard_time_ms = 0;  // Limits enforced by the main search thread only
+    uint64_t node_limit = 0;
+    bool can_abort = false;    // False until the first iteration has completed
+
+    // --- Move Ordering Heuristics ---
+    // Per-thread tables filled by quiet moves that cause a beta cutoff. Killers
+    // are cleared and history halved at the start of every find_best_move.
+    void _clear_move_ordering();
+    void _age_move_ordering();
+    void _update_quiet_stats(const Move& move, int ply, int depth, const Move* quiets_tried, int quiet_count);
+    Move _countermove(int ply) const;
+    static const int MAX_HISTORY = 16384;
+    static const int CAPTURE_SCORE = 1 << 24;
+    static const int KILLER_SCORE = 1 << 22;
+    static const int COUNTERMOVE_SCORE = 1 << 21;
+    Move killers[MAX_DEPTH + 1][2];
+    int history[2][64][64] = {};
+    Move countermoves[12][64];    // Indexed by the previous move's piece and target square
+    Move ply_moves[MAX_DEPTH + 1]; // Move played at each ply of the current line, {-1, -1} for a null move
 
-    // --- Zobrist Hashing & Transposition Table ---
-    void init_zobrist();
-    uint64_t compute_zobrist_hash() const;
-    uint64_t current_hash;
-    std::vector<std::vector<uint64_t>> piece_keys;
-    uint64_t turn_key;
-    std::unordered_map<uint64_t, TT_Entry> transposition_table;
-    int piece_map(char p) const;
-
-    // --- Evaluation Data ---
-    std::unordered_map<char, int> piece_values;
-    std::unordered_map<char, std::vector<std::vector<int>>> pst;
+    // --- Transposition Table ---
+    // Mate scores count plies from the root; the table keeps them as plies from
+    // the stored node, since the entry may be reached at another ply or move.
+    static int _score_to_tt(int score, int ply) {
+        return !is_mate_score(score) ? score : score > 0 ? score + ply : score - ply;
+    }
+    static int _score_from_tt(int score, int ply) {
+        return !is_mate_score(score) ? score : score > 0 ? score - ply : score + ply;
+    }
+    std::shared_ptr<TranspositionTable> transposition_table = std::make_shared<TranspositionTable>(); // Shared by copies
+    bool owns_hash = true; // False after share_hash
 };
 
 #endif // CYRUS_H
\ No newline at end of file
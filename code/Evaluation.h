@@ -0,0 +1,112 @@
+#ifndef EVALUATION_H
+#define EVALUATION_H
+
+#include "Bitboard.h"
+
+// Material and piece-square tables, indexed by PieceType and square. All of
+// them are compile-time constants with a single copy in the program.
+// Evaluation is from White's side: White pieces read PST[type][sq] and Black
+// pieces the row-mirrored square, as the original per-piece maps did.
+
+inline constexpr int PIECE_VALUES[6] = {100, 320, 280, 500, 105, 20000};
+
+inline constexpr int PST[6][64] = {
+    // Pawn
+    {
+          0,   0,   0,   0,   0,   0,   0,   0,
+          5,  10,  10, -20, -20,  10,  10,   5,
+          5,  -5, -10,   0,   0, -10,  -5,   5,
+          0,   0,   0,  20,  20,   0,   0,   0,
+          5,   5,  10,  25,  25,  10,   5,   5,
+         10,  10,  20,  30,  30,  20,  10,  10,
+         50,  50,  50,  50,  50,  50,  50,  50,
+          0,   0,   0,   0,   0,   0,   0,   0
+    },
+    // Faras (Knight)
+    {
+        -50, -40, -30, -30, -30, -30, -40, -50,
+        -40, -20,   0,   5,   5,   0, -20, -40,
+        -30,   5,  10,  15,  15,  10,   5, -30,
+        -30,   0,  15,  20,  20,  15,   0, -30,
+        -30,   5,  15,  20,  20,  15,   5, -30,
+        -30,   0,  10,  15,  15,  10,   0, -30,
+        -40, -20,   0,   0,   0,   0, -20, -40,
+        -50, -40, -30, -30, -30, -30, -40, -50
+    },
+    // Fil (Elephant)
+    {
+        -10, -10, -10, -10, -10, -10, -10, -10,
+        -10,   0,   0,   0,   0,   0,   0, -10,
+        -10,   0,   5,  10,  10,   5,   0, -10,
+        -10,   5,   5,  10,  10,   5,   5, -10,
+        -10,   0,  10,  10,  10,  10,   0, -10,
+        -10,  10,  10,  10,  10,  10,  10, -10,
+        -10,   5,   0,   0,   0,   0,   5, -10,
+        -10, -10, -10, -10, -10, -10, -10, -10
+    },
+    // Rukh (Rook)
+    {
+          0,   0,   0,   5,   5,   0,   0,   0,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+          5,  10,  10,  10,  10,  10,  10,   5,
+          0,   0,   0,   0,   0,   0,   0,   0
+    },
+    // Ferz (Counselor)
+    {
+        -10, -10, -10,  -5,  -5, -10, -10, -10,
+        -10,   0,   0,   0,   0,   0,   0, -10,
+        -10,   0,   5,   5,   5,   5,   0, -10,
+         -5,   0,   5,   5,   5,   5,   0,  -5,
+          0,   0,   5,   5,   5,   5,   0,  -5,
+        -10,   5,   5,   5,   5,   5,   0, -10,
+        -10,   0,   5,   0,   0,   0,   0, -10,
+        -10, -10, -10,  -5,  -5, -10, -10, -10
+    },
+    // Shah (King)
+    {
+         20,  30,  10,   0,   0,  10,  30,  20,
+         20,  20,   0,   0,   0,   0,  20,  20,
+        -10, -20, -20, -20, -20, -20, -20, -10,
+        -20, -30, -30, -40, -40, -30, -30, -20,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30
+    }
+};
+
+// Signed value of each piece (index type * 2 + color) on each square: positive
+// for White, negative for Black. This is what make_move adds and removes.
+struct PieceSquareTable {
+    int values[12][64];
+};
+
+constexpr PieceSquareTable build_piece_square_table() {
+    PieceSquareTable t{};
+    for (int type = 0; type < 6; ++type) {
+        for (int sq = 0; sq < 64; ++sq) {
+            int mirrored = (7 - sq / 8) * 8 + sq % 8;
+            t.values[make_piece(type, WHITE)][sq] = PIECE_VALUES[type] + PST[type][sq];
+            t.values[make_piece(type, BLACK)][sq] = -(PIECE_VALUES[type] + PST[type][mirrored]);
+        }
+    }
+    return t;
+}
+
+inline constexpr PieceSquareTable PIECE_SQUARE = build_piece_square_table();
+
+// Material + PST score of a whole position, White's view
+constexpr int evaluate_pieces(const Bitboards& bb) {
+    int score = 0;
+    for (int piece = 0; piece < 12; ++piece) {
+        uint64_t b = bb.pieces[piece];
+        while (b) score += PIECE_SQUARE.values[piece][pop_lsb(b)];
+    }
+    return score;
+}
+
+#endif // EVALUATION_H
@@ -0,0 +1,46 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// A whole file mapped into memory. Read-only maps share the page cache between
+// processes; copy-on-write maps may be modified in memory without touching the
+// file. The mapping lives until close() or destruction.
+class MappedFile {
+public:
+    enum Mode { READ_ONLY, COPY_ON_WRITE };
+
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept : base(other.base), length(other.length) {
+        other.base = nullptr;
+        other.length = 0;
+    }
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            base = other.base;
+            length = other.length;
+            other.base = nullptr;
+            other.length = 0;
+        }
+        return *this;
+    }
+
+    bool open(const std::string& path, Mode mode = READ_ONLY); // false if missing, empty or unmappable
+    void close();
+
+    bool is_open() const { return base != nullptr; }
+    const unsigned char* data() const { return static_cast<const unsigned char*>(base); }
+    unsigned char* mutable_data() { return static_cast<unsigned char*>(base); } // COPY_ON_WRITE only
+    size_t size() const { return length; }
+
+private:
+    void* base = nullptr;
+    size_t length = 0;
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,45 @@
+#ifndef MOVE_H
+#define MOVE_H
+
+#include <cstdint>
+
+// Represents a single move (from square 0-63, to square 0-63)
+struct Move {
+    int from;
+    int to;
+    char promotion = ' '; // For potential future use, not in Shatranj
+
+    bool operator==(const Move& other) const {
+        return from == other.from && to == other.to;
+    }
+    bool operator!=(const Move& other) const { return !(*this == other); }
+};
+
+// 16-bit move encoding used by the transposition table, 0 for no move
+inline uint16_t pack_move(const Move& move) { return static_cast<uint16_t>(move.from | move.to << 6); }
+inline Move unpack_move(uint16_t packed) { return {packed & 63, packed >> 6}; }
+
+// Upper bound on the moves of one side: two rooks (28), two Faras (16), two Fil
+// (8), the Shah (8) and up to nine Ferz after promotions (36) come to 96.
+const int MAX_MOVES = 128;
+
+// Fixed-capacity move list that lives on the stack, with a score slot per move
+// for ordering. Used everywhere inside the search instead of std::vector.
+struct MoveList {
+    Move moves[MAX_MOVES];
+    int scores[MAX_MOVES];
+    int count = 0;
+
+    void push_back(const Move& move) { moves[count++] = move; }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    void clear() { count = 0; }
+    Move& operator[](int i) { return moves[i]; }
+    const Move& operator[](int i) const { return moves[i]; }
+    Move* begin() { return moves; }
+    Move* end() { return moves + count; }
+    const Move* begin() const { return moves; }
+    const Move* end() const { return moves + count; }
+};
+
+#endif // MOVE_H
@@ -0,0 +1,90 @@
+#include "MovePicker.h"
+#include "Evaluation.h"
+
+MovePicker::MovePicker(CyrusEngine& engine, char turn, uint16_t tt_move, int ply)
+    : engine(engine), turn(turn), ply(ply), captures_only(false), stage(STAGE_TT_MOVE) {
+    if (tt_move && engine._is_legal(unpack_move(tt_move), turn)) {
+        this->tt_move = unpack_move(tt_move);
+    } else {
+        stage = STAGE_INIT_CAPTURES;
+    }
+}
+
+MovePicker::MovePicker(CyrusEngine& engine, char turn)
+    : engine(engine), turn(turn), captures_only(true), stage(STAGE_INIT_CAPTURES) {}
+
+bool MovePicker::next(Move& move) {
+    switch (stage) {
+        case STAGE_TT_MOVE:
+            stage = STAGE_INIT_CAPTURES;
+            move = tt_move;
+            return true;
+
+        case STAGE_INIT_CAPTURES:
+            moves.clear();
+            engine._generate_moves(turn, GEN_CAPTURES, moves);
+            for (int i = 0; i < moves.size(); ++i) moves.scores[i] = engine._score_move(moves[i]);
+            index = 0;
+            stage = STAGE_CAPTURES;
+            // Fall through
+        case STAGE_CAPTURES:
+            while (_select_best(move)) {
+                if (move == tt_move) continue;
+                if (_loses_material(move)) {
+                    if (!captures_only) bad_captures.push_back(move);
+                    continue;
+                }
+                return true;
+            }
+            if (captures_only) {
+                stage = STAGE_DONE;
+                return false;
+            }
+            stage = STAGE_INIT_QUIETS;
+            // Fall through
+        case STAGE_INIT_QUIETS:
+            moves.clear();
+            engine._generate_moves(turn, GEN_QUIETS, moves);
+            for (int i = 0; i < moves.size(); ++i) moves.scores[i] = engine._score_quiet(moves[i], ply);
+            index = 0;
+            stage = STAGE_QUIETS;
+            // Fall through
+        case STAGE_QUIETS:
+            while (_select_best(move)) {
+                if (move != tt_move) return true;
+            }
+            stage = STAGE_BAD_CAPTURES;
+            // Fall through
+        case STAGE_BAD_CAPTURES:
+            if (bad_index < bad_captures.size()) {
+                move = bad_captures[bad_index++];
+                return true;
+            }
+            stage = STAGE_DONE;
+            // Fall through
+        default:
+            return false;
+    }
+}
+
+bool MovePicker::_select_best(Move& move) {
+    if (index >= moves.size()) return false;
+    // Selection step: swap the best remaining move into place
+    int best = index;
+    for (int i = index + 1; i < moves.size(); ++i) {
+        if (moves.scores[i] > moves.scores[best]) best = i;
+    }
+    std::swap(moves.moves[index], moves.moves[best]);
+    std::swap(moves.scores[index], moves.scores[best]);
+    move = moves[index++];
+    return true;
+}
+
+bool MovePicker::_loses_material(const Move& capture) const {
+    if (!engine.features.see) return false;
+    // Taking a piece worth at least the capturer can't lose material; skip the exchange
+    int victim = piece_type(engine.position.piece_on(capture.to));
+    int attacker = piece_type(engine.position.piece_on(capture.from));
+    if (PIECE_VALUES[victim] >= PIECE_VALUES[attacker]) return false;
+    return engine.see(capture) < 0;
+}
@@ -0,0 +1,42 @@
+#ifndef MOVE_PICKER_H
+#define MOVE_PICKER_H
+
+#include "Cyrus.h"
+
+// Staged move picker for the search. Moves come out as
+//   1. the transposition table move, if it is legal here,
+//   2. captures that do not lose material by SEE, best MVV-LVA score first,
+//      selected one at a time,
+//   3. quiet moves: killers, then the countermove, then by history score,
+//   4. losing captures, in the order they were found.
+// The quiescence picker stops after stage 2, so losing captures are skipped.
+// A stage is generated only once the previous one runs dry, so a node that
+// cuts off early never generates, scores or sorts the rest of its moves.
+class MovePicker {
+public:
+    MovePicker(CyrusEngine& engine, char turn, uint16_t tt_move, int ply); // Main search
+    MovePicker(CyrusEngine& engine, char turn);                   // Quiescence: captures only
+
+    // Writes the next move to `move`; false once every stage is exhausted.
+    bool next(Move& move);
+
+private:
+    enum Stage { STAGE_TT_MOVE, STAGE_INIT_CAPTURES, STAGE_CAPTURES, STAGE_INIT_QUIETS, STAGE_QUIETS,
+                 STAGE_BAD_CAPTURES, STAGE_DONE };
+
+    CyrusEngine& engine;
+    char turn;
+    int ply = 0;
+    Move tt_move = {-1, -1};
+    bool captures_only;
+    int stage;
+    MoveList moves;
+    int index = 0;
+    MoveList bad_captures; // Captures that lose material, tried after the quiet moves
+    int bad_index = 0;
+
+    bool _select_best(Move& move); // Swaps the best-scored remaining move to `index` and takes it
+    bool _loses_material(const Move& capture) const;
+};
+
+#endif // MOVE_PICKER_H
@@ -0,0 +1,206 @@
+#include "Nnue.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CYRUS_NNUE_X86 1
+#endif
+
+static const char FILE_MAGIC[8] = {'C', 'Y', 'R', 'U', 'S', 'N', 'N', 0};
+static const int HIDDEN = NnueNetwork::HIDDEN;
+
+// One set of kernels. update writes dst = src + every added row - every
+// removed row (dst may be src); output is the clipped-ReLU dot product of one
+// half of an accumulator with its output weights.
+struct Kernels {
+    const char* name;
+    void (*update)(const int16_t* src, int16_t* dst, const int16_t* const* added, int added_count,
+                   const int16_t* const* removed, int removed_count);
+    int32_t (*output)(const int16_t* acc, const int8_t* weights);
+};
+
+static void update_scalar(const int16_t* src, int16_t* dst, const int16_t* const* added, int added_count,
+                          const int16_t* const* removed, int removed_count) {
+    for (int i = 0; i < HIDDEN; ++i) {
+        int16_t v = src[i];
+        for (int a = 0; a < added_count; ++a) v = static_cast<int16_t>(v + added[a][i]);
+        for (int r = 0; r < removed_count; ++r) v = static_cast<int16_t>(v - removed[r][i]);
+        dst[i] = v;
+    }
+}
+
+static int32_t output_scalar(const int16_t* acc, const int8_t* weights) {
+    int32_t sum = 0;
+    for (int i = 0; i < HIDDEN; ++i) {
+        int v = std::min(std::max(static_cast<int>(acc[i]), 0), static_cast<int>(NnueNetwork::ACTIVATION_MAX));
+        sum += v * weights[i];
+    }
+    return sum;
+}
+
+#ifdef CYRUS_NNUE_X86
+static void update_sse2(const int16_t* src, int16_t* dst, const int16_t* const* added, int added_count,
+                        const int16_t* const* removed, int removed_count) {
+    for (int i = 0; i < HIDDEN; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        for (int a = 0; a < added_count; ++a) {
+            v = _mm_add_epi16(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(added[a] + i)));
+        }
+        for (int r = 0; r < removed_count; ++r) {
+            v = _mm_sub_epi16(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(removed[r] + i)));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+    }
+}
+
+static int32_t output_sse2(const int16_t* acc, const int8_t* weights) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ceiling = _mm_set1_epi16(NnueNetwork::ACTIVATION_MAX);
+    __m128i sum = zero;
+    for (int i = 0; i < HIDDEN; i += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i));
+        a = _mm_min_epi16(_mm_max_epi16(a, zero), ceiling);
+        // Eight int8 weights, sign-extended to int16
+        __m128i w = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(weights + i));
+        w = _mm_srai_epi16(_mm_unpacklo_epi8(w, w), 8);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(a, w));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+}
+
+__attribute__((target("avx2")))
+static void update_avx2(const int16_t* src, int16_t* dst, const int16_t* const* added, int added_count,
+                        const int16_t* const* removed, int removed_count) {
+    for (int i = 0; i < HIDDEN; i += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        for (int a = 0; a < added_count; ++a) {
+            v = _mm256_add_epi16(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(added[a] + i)));
+        }
+        for (int r = 0; r < removed_count; ++r) {
+            v = _mm256_sub_epi16(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(removed[r] + i)));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+    }
+}
+
+__attribute__((target("avx2")))
+static int32_t output_avx2(const int16_t* acc, const int8_t* weights) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ceiling = _mm256_set1_epi16(NnueNetwork::ACTIVATION_MAX);
+    __m256i sum = zero;
+    for (int i = 0; i < HIDDEN; i += 16) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+        a = _mm256_min_epi16(_mm256_max_epi16(a, zero), ceiling);
+        __m256i w = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i)));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(a, w));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    return _mm_cvtsi128_si32(half);
+}
+#endif
+
+static const Kernels SCALAR_KERNELS = {"scalar", update_scalar, output_scalar};
+#ifdef CYRUS_NNUE_X86
+static const Kernels SSE2_KERNELS = {"sse2", update_sse2, output_sse2};
+static const Kernels AVX2_KERNELS = {"avx2", update_avx2, output_avx2};
+#endif
+
+static const Kernels* best_kernels() {
+#ifdef CYRUS_NNUE_X86
+    if (__builtin_cpu_supports("avx2")) return &AVX2_KERNELS;
+    if (__builtin_cpu_supports("sse2")) return &SSE2_KERNELS;
+#endif
+    return &SCALAR_KERNELS;
+}
+
+static const Kernels* active_kernels = best_kernels();
+
+const char* NnueNetwork::kernels() {
+    return active_kernels->name;
+}
+
+bool NnueNetwork::use_kernels(const std::string& name) {
+    // In order of what they need from the CPU, so everything up to the best one runs
+    static const Kernels* const ALL[] = {
+        &SCALAR_KERNELS,
+#ifdef CYRUS_NNUE_X86
+        &SSE2_KERNELS, &AVX2_KERNELS,
+#endif
+    };
+    const Kernels* best = best_kernels();
+    for (const Kernels* k : ALL) {
+        if (name == k->name) {
+            active_kernels = k;
+            return true;
+        }
+        if (k == best) break;
+    }
+    return false;
+}
+
+bool NnueNetwork::open(const std::string& path) {
+    MappedFile mapped;
+    if (!mapped.open(path, MappedFile::READ_ONLY) || mapped.size() < sizeof(FileHeader)) return false;
+    FileHeader header;
+    std::memcpy(&header, mapped.data(), sizeof(header));
+    size_t expected = sizeof(FileHeader) + HIDDEN * sizeof(int16_t) + INPUTS * HIDDEN * sizeof(int16_t)
+                    + 2 * HIDDEN * sizeof(int8_t) + sizeof(int32_t);
+    if (std::memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != FILE_VERSION
+        || header.byte_order != BYTE_ORDER_MARK || header.inputs != INPUTS || header.hidden != HIDDEN
+        || header.output_divisor <= 0 || mapped.size() != expected) {
+        return false;
+    }
+
+    file = std::move(mapped);
+    const unsigned char* p = file.data() + sizeof(FileHeader);
+    biases = reinterpret_cast<const int16_t*>(p);
+    p += HIDDEN * sizeof(int16_t);
+    weights = reinterpret_cast<const int16_t*>(p);
+    p += INPUTS * HIDDEN * sizeof(int16_t);
+    output_weights = reinterpret_cast<const int8_t*>(p);
+    p += 2 * HIDDEN * sizeof(int8_t);
+    std::memcpy(&output_bias, p, sizeof(output_bias));
+    output_divisor = header.output_divisor;
+    return true;
+}
+
+void NnueNetwork::refresh(const Bitboards& bb, Accumulator& acc) const {
+    for (int perspective : {WHITE, BLACK}) {
+        const int16_t* rows[64];
+        int count = 0;
+        for (int piece = 0; piece < 12; ++piece) {
+            uint64_t b = bb.pieces[piece];
+            while (b) rows[count++] = weights + feature(perspective, piece, pop_lsb(b)) * HIDDEN;
+        }
+        active_kernels->update(biases, acc.values[perspective], rows, count, nullptr, 0);
+    }
+}
+
+void NnueNetwork::update(const Accumulator& from, Accumulator& to, const Feature* removed, int removed_count,
+                         const Feature* added, int added_count) const {
+    for (int perspective : {WHITE, BLACK}) {
+        const int16_t* removed_rows[2];
+        const int16_t* added_rows[2];
+        for (int i = 0; i < removed_count; ++i) {
+            removed_rows[i] = weights + feature(perspective, removed[i].piece, removed[i].square) * HIDDEN;
+        }
+        for (int i = 0; i < added_count; ++i) {
+            added_rows[i] = weights + feature(perspective, added[i].piece, added[i].square) * HIDDEN;
+        }
+        active_kernels->update(from.values[perspective], to.values[perspective], added_rows, added_count,
+                               removed_rows, removed_count);
+    }
+}
+
+int NnueNetwork::evaluate(const Accumulator& acc, int side_to_move) const {
+    int64_t sum = output_bias;
+    sum += active_kernels->output(acc.values[side_to_move], output_weights);
+    sum += active_kernels->output(acc.values[side_to_move ^ 1], output_weights + HIDDEN);
+    int64_t score = sum / output_divisor;
+    return static_cast<int>(std::min<int64_t>(std::max<int64_t>(score, -MAX_SCORE), MAX_SCORE));
+}
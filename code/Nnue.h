@@ -0,0 +1,86 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include <cstdint>
+#include <string>
+#include "Bitboard.h"
+#include "MappedFile.h"
+
+// Optional neural evaluation (NNUE-style): a piece-square input layer feeding
+// a clipped-ReLU hidden layer of HIDDEN units per side, then one output.
+//
+// Each side sees the board from its own point of view: for Black the board is
+// flipped top to bottom and the colors swapped, so feature (piece, square) means
+// the same thing to both. The first layer's sums for both views make up an
+// Accumulator; a move only changes two or three features, so the search keeps
+// one accumulator per ply and updates it from the previous one rather than
+// summing every piece again.
+//
+// The network file is a 64-byte header followed by, all little-endian:
+//   int16 feature_biases[HIDDEN]
+//   int16 feature_weights[INPUTS][HIDDEN]
+//   int8  output_weights[2 * HIDDEN]   side to move's half first
+//   int32 output_bias
+// It is memory-mapped read-only, so processes and engines share one copy.
+// The score, in centipawns for the side to move, is
+//   (output_bias + sum of clamp(accumulator, 0, ACTIVATION_MAX) * output_weight) / output_divisor
+//
+// The kernels use AVX2 or SSE2 when the CPU has them, chosen at startup, and
+// plain C++ otherwise; all of them give identical results.
+class NnueNetwork {
+public:
+    static const int INPUTS = 12 * 64;
+    static const int HIDDEN = 256;
+    static const int ACTIVATION_MAX = 127;
+    static const int MAX_SCORE = 30000; // Outputs are clamped below every tablebase and mate score
+
+    struct alignas(64) Accumulator {
+        int16_t values[2][HIDDEN]; // Indexed by the color whose view it is
+        uint64_t hash = 0;         // Position it was computed for, 0 if none
+    };
+
+    bool open(const std::string& path); // False if missing or not a network of this version
+    bool is_open() const { return file.is_open(); }
+
+    // Sums every piece on the board from scratch
+    void refresh(const Bitboards& bb, Accumulator& acc) const;
+    // `to` = `from` less the removed pieces plus the added ones, at most two
+    // of each (a capture removes two and a move adds one)
+    struct Feature { int piece; int square; };
+    void update(const Accumulator& from, Accumulator& to, const Feature* removed, int removed_count,
+                const Feature* added, int added_count) const;
+    int evaluate(const Accumulator& acc, int side_to_move) const;
+
+    // Index of (piece, square) as seen by `perspective`
+    static int feature(int perspective, int piece, int square) {
+        return perspective == WHITE ? piece * 64 + square : (piece ^ 1) * 64 + (square ^ 56);
+    }
+
+    // The kernels in use: "avx2", "sse2" or "scalar". use_kernels switches to
+    // another set, for comparison; false if this CPU cannot run it.
+    static const char* kernels();
+    static bool use_kernels(const std::string& name);
+
+private:
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t inputs;
+        uint64_t byte_order;
+        uint32_t hidden;
+        int32_t output_divisor;
+        uint64_t reserved[4];
+    };
+    static_assert(sizeof(FileHeader) == 64, "network header should keep the weights cache-line aligned");
+    static const uint32_t FILE_VERSION = 1;
+    static const uint64_t BYTE_ORDER_MARK = 0x0102030405060708ULL;
+
+    MappedFile file;
+    const int16_t* biases = nullptr;
+    const int16_t* weights = nullptr;
+    const int8_t* output_weights = nullptr;
+    int32_t output_bias = 0;
+    int32_t output_divisor = 1;
+};
+
+#endif // NNUE_H
@@ -0,0 +1,47 @@
+#include "OpeningBook.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+static const char FILE_MAGIC[8] = {'C', 'Y', 'R', 'U', 'S', 'B', 'K', 0};
+
+bool OpeningBook::open(const std::string& path) {
+    MappedFile mapped;
+    if (!mapped.open(path, MappedFile::READ_ONLY) || mapped.size() < sizeof(FileHeader)) return false;
+    FileHeader header;
+    std::memcpy(&header, mapped.data(), sizeof(header));
+    if (std::memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != FILE_VERSION
+        || header.entry_size != sizeof(BookEntry) || header.byte_order != BYTE_ORDER_MARK
+        || mapped.size() != sizeof(FileHeader) + header.count * sizeof(BookEntry)) {
+        return false;
+    }
+    file = std::move(mapped);
+    entries = reinterpret_cast<const BookEntry*>(file.data() + sizeof(FileHeader));
+    count = header.count;
+    return true;
+}
+
+std::vector<BookEntry> OpeningBook::lookup(uint64_t key) const {
+    auto by_key = [](const BookEntry& e, uint64_t k) { return e.key < k; };
+    const BookEntry* first = std::lower_bound(entries, entries + count, key, by_key);
+    std::vector<BookEntry> found;
+    for (const BookEntry* e = first; e != entries + count && e->key == key; ++e) found.push_back(*e);
+    return found; // Already in weight order, as written
+}
+
+bool OpeningBook::write(const std::string& path, std::vector<BookEntry> entries) {
+    std::sort(entries.begin(), entries.end(), [](const BookEntry& a, const BookEntry& b) {
+        return a.key != b.key ? a.key < b.key : a.weight > b.weight;
+    });
+    FileHeader header = {};
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+    header.version = FILE_VERSION;
+    header.entry_size = sizeof(BookEntry);
+    header.byte_order = BYTE_ORDER_MARK;
+    header.count = entries.size();
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(BookEntry)));
+    return static_cast<bool>(out);
+}
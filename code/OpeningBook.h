@@ -0,0 +1,51 @@
+#ifndef OPENING_BOOK_H
+#define OPENING_BOOK_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+// One book move: the Zobrist key of the position (CyrusEngine::hash()), the
+// move packed as from | to << 6, and a weight, higher for better moves.
+struct BookEntry {
+    uint64_t key;
+    uint16_t move;
+    uint16_t weight;
+    uint32_t reserved;
+};
+static_assert(sizeof(BookEntry) == 16, "book entries are stored as they sit in memory");
+
+// Read-only opening book, memory-mapped so every process using the same file
+// shares one copy in the page cache. The file is a 32-byte header followed by
+// entries sorted by key, so a lookup is a binary search over the mapping.
+class OpeningBook {
+public:
+    bool open(const std::string& path); // False if missing or not a book of this version
+    bool is_open() const { return entries != nullptr; }
+    size_t size() const { return count; }
+
+    // Entries for one position, highest weight first; empty if out of book
+    std::vector<BookEntry> lookup(uint64_t key) const;
+
+    // Sorts `entries` by key, then weight, and writes them as a book file
+    static bool write(const std::string& path, std::vector<BookEntry> entries);
+
+private:
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t entry_size;
+        uint64_t byte_order;
+        uint64_t count;
+    };
+    static_assert(sizeof(FileHeader) == 32, "book header should keep the entries 8-byte aligned");
+    static const uint32_t FILE_VERSION = 2; // 2: compile-time Zobrist keys
+    static const uint64_t BYTE_ORDER_MARK = 0x0102030405060708ULL;
+
+    MappedFile file;
+    const BookEntry* entries = nullptr;
+    size_t count = 0;
+};
+
+#endif // OPENING_BOOK_H
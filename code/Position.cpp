@@ -0,0 +1,167 @@
+#include "Position.h"
+#include "Attacks.h"
+#include "Evaluation.h"
+#include "Zobrist.h"
+#include <cassert>
+#include <sstream>
+
+// The start position, set up, hashed and evaluated at compile time, so a new
+// position only copies it
+struct StartPosition {
+    Bitboards bitboards;
+    uint64_t hash;
+    int eval;
+};
+
+static constexpr StartPosition build_start_position() {
+    constexpr char LAYOUT[] = "rnbkqbnr" "pppppppp" "........" "........"
+                              "........" "........" "PPPPPPPP" "RNBKQBNR";
+    StartPosition start{};
+    start.bitboards.clear();
+    for (int sq = 0; sq < 64; ++sq) {
+        int piece = piece_from_char(LAYOUT[sq]);
+        if (piece != NO_PIECE) start.bitboards.put(piece, sq);
+    }
+    start.hash = zobrist::hash(start.bitboards, true);
+    start.eval = evaluate_pieces(start.bitboards);
+    return start;
+}
+
+static constexpr StartPosition START_POSITION = build_start_position();
+
+Position::Position()
+    : bb(START_POSITION.bitboards), key(START_POSITION.hash), score(START_POSITION.eval), side(WHITE) {}
+
+void Position::set(const Bitboards& board, int side_to_move) {
+    bb = board;
+    side = side_to_move;
+    key = zobrist::hash(bb, side == WHITE);
+    score = evaluate_pieces(bb);
+    undo_count = 0;
+}
+
+void Position::set_side_to_move(int color) {
+    if (color != side) {
+        side = color;
+        key ^= zobrist::KEYS.turn;
+    }
+}
+
+bool Position::set_fen(const std::string& fen) {
+    std::istringstream in(fen);
+    std::string placement, side_field, castling = "-", en_passant = "-";
+    if (!(in >> placement >> side_field)) return false;
+    in >> castling >> en_passant;
+    if ((side_field != "w" && side_field != "b") || castling != "-" || en_passant != "-") return false;
+
+    Bitboards board;
+    board.clear();
+    int row = 0, col = 0;
+    int kings[2] = {0, 0};
+    for (char c : placement) {
+        if (c == '/') {
+            if (col != 8 || ++row > 7) return false;
+            col = 0;
+        } else if (c >= '1' && c <= '8') {
+            col += c - '0';
+            if (col > 8) return false;
+        } else {
+            int piece = piece_from_char(c);
+            if (piece == NO_PIECE || col > 7) return false;
+            if (piece_type(piece) == SHAH) ++kings[piece_color(piece)];
+            board.put(piece, row * 8 + col++);
+        }
+    }
+    if (row != 7 || col != 8 || kings[WHITE] != 1 || kings[BLACK] != 1) return false;
+    set(board, side_field == "w" ? WHITE : BLACK);
+    return true;
+}
+
+std::string Position::fen() const {
+    std::string fen;
+    for (int r = 0; r < 8; ++r) {
+        int empty = 0;
+        for (int c = 0; c < 8; ++c) {
+            int piece = bb.piece_on(r * 8 + c);
+            if (piece == NO_PIECE) {
+                ++empty;
+                continue;
+            }
+            if (empty) fen += static_cast<char>('0' + empty);
+            empty = 0;
+            fen += PIECE_CHARS[piece];
+        }
+        if (empty) fen += static_cast<char>('0' + empty);
+        if (r < 7) fen += '/';
+    }
+    fen += side == WHITE ? " w - - 0 1" : " b - - 0 1";
+    return fen;
+}
+
+bool Position::attacked(int square, int by_color) const {
+    int them = by_color;
+    // A pawn of `them` attacks `square` exactly when a pawn of ours on `square` would attack it back
+    return (attacks::PAWN_ATTACKS[them ^ 1][square] & bb.of(PAWN, them))
+        || (attacks::FARAS_ATTACKS[square] & bb.of(FARAS, them))
+        || (attacks::FIL_ATTACKS[square] & bb.of(FIL, them))
+        || (attacks::FERZ_ATTACKS[square] & bb.of(FERZ, them))
+        || (attacks::SHAH_ATTACKS[square] & bb.of(SHAH, them))
+        || (attacks::rukh_attacks(square, bb.occupied) & bb.of(RUKH, them));
+}
+
+bool Position::in_check(int color) const {
+    uint64_t king = bb.of(SHAH, color);
+    if (!king) return true; // King not found, which is a game-ending state
+    return attacked(lsb(king), color ^ 1);
+}
+
+void Position::make_move(const Move& move) {
+    assert(undo_count < MAX_PLY && "position undo stack overflow");
+    int piece = bb.piece_on(move.from);
+    int target = bb.piece_on(move.to);
+    undo[undo_count++] = {key, score, pack_move(move), static_cast<int8_t>(piece), static_cast<int8_t>(target)};
+
+    // Update hash: xor out pieces from their squares
+    key ^= zobrist::KEYS.pieces[piece][move.from];
+    score -= PIECE_SQUARE.values[piece][move.from];
+    bb.remove(piece, move.from);
+    if (target != NO_PIECE) {
+        key ^= zobrist::KEYS.pieces[target][move.to];
+        score -= PIECE_SQUARE.values[target][move.to];
+        bb.remove(target, move.to);
+    }
+
+    // Promotion (to Ferz/Counselor)
+    int row = move.to / 8;
+    int placed = piece;
+    if (piece_type(piece) == PAWN && (row == 0 || row == 7)) {
+        placed = make_piece(FERZ, piece_color(piece));
+    }
+    bb.put(placed, move.to);
+    key ^= zobrist::KEYS.pieces[placed][move.to];
+    score += PIECE_SQUARE.values[placed][move.to];
+
+    key ^= zobrist::KEYS.turn;
+    side ^= 1;
+}
+
+void Position::make_null_move() {
+    assert(undo_count < MAX_PLY && "position undo stack overflow");
+    undo[undo_count++] = {key, score, 0, NO_PIECE, NO_PIECE};
+    key ^= zobrist::KEYS.turn;
+    side ^= 1;
+}
+
+void Position::unmake_move() {
+    assert(undo_count > 0 && "unmake_move without a move to take back");
+    const Undo& u = undo[--undo_count];
+    side ^= 1;
+    key = u.hash;
+    score = u.eval;
+    if (u.piece == NO_PIECE) return; // Null move
+
+    Move move = unpack_move(u.move);
+    bb.remove(bb.piece_on(move.to), move.to); // Might be a promoted piece
+    bb.put(u.piece, move.from);
+    if (u.captured != NO_PIECE) bb.put(u.captured, move.to);
+}
@@ -0,0 +1,75 @@
+#ifndef POSITION_H
+#define POSITION_H
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include "Bitboard.h"
+#include "Move.h"
+
+// One game state: the board, the side to move, its Zobrist hash and the running
+// material + PST score, with a stack of undo records so a move can be taken
+// back without the caller remembering what it moved or captured.
+//
+// A Position owns no memory and points at nothing; every table it reads
+// (attacks, Zobrist keys, piece-square values) is a compile-time constant. Each
+// search thread or game keeps its own copy, and copying one is a memcpy.
+class Position {
+public:
+    // Deepest line of make_move calls without an unmake: a search line of
+    // MAX_DEPTH plies plus its quiescence captures, which run out with the pieces
+    static const int MAX_PLY = 128;
+
+    Position(); // The start position
+
+    // Shatranj FEN as described at CyrusEngine::set_fen
+    bool set_fen(const std::string& fen); // False, leaving the position unchanged, if malformed
+    std::string fen() const;
+    void set(const Bitboards& bb, int side_to_move); // Also empties the undo stack
+
+    const Bitboards& board() const { return bb; }
+    int piece_on(int square) const { return bb.piece_on(square); }
+    int side_to_move() const { return side; }
+    void set_side_to_move(int color);
+    uint64_t hash() const { return key; }
+    int eval() const { return score; } // White's view
+    int ply() const { return undo_count; } // Moves that unmake_move can take back
+
+    bool attacked(int square, int by_color) const;
+    bool in_check(int color) const;
+
+    // The move must be pseudo-legal. A pawn reaching the last row becomes a Ferz.
+    void make_move(const Move& move);
+    void unmake_move(); // Takes back the last make_move or make_null_move
+    void make_null_move();
+    void unmake_null_move() { unmake_move(); }
+    // A move of the game rather than the search: it cannot be taken back, so a
+    // whole game fits however long it runs
+    void play(const Move& move) {
+        make_move(move);
+        --undo_count;
+    }
+
+    // What the move at undo stack entry `ply` (0 = the oldest) changed, for an
+    // evaluator that follows the position move by move
+    struct Undo {
+        uint64_t hash;   // Before the move
+        int32_t eval;
+        uint16_t move;   // Packed
+        int8_t piece;    // As it stood on the from square; NO_PIECE for a null move
+        int8_t captured;
+    };
+    const Undo& undo_entry(int ply) const { return undo[ply]; }
+
+private:
+    Bitboards bb;
+    uint64_t key;
+    int32_t score;
+    int32_t side;
+    int32_t undo_count = 0;
+    Undo undo[MAX_PLY];
+};
+
+static_assert(std::is_trivially_copyable<Position>::value, "positions are copied between threads with memcpy");
+
+#endif // POSITION_H
@@ -0,0 +1,45 @@
+#include "SearchStats.h"
+#include <sstream>
+#include <iomanip>
+
+void SearchStats::merge(const SearchStats& other) {
+    nodes += other.nodes;
+    qnodes += other.qnodes;
+    tt_probes += other.tt_probes;
+    tt_hits += other.tt_hits;
+    tt_cutoffs += other.tt_cutoffs;
+    beta_cutoffs += other.beta_cutoffs;
+    first_move_cutoffs += other.first_move_cutoffs;
+    interior_nodes += other.interior_nodes;
+    moves_searched += other.moves_searched;
+    tb_hits += other.tb_hits;
+}
+
+std::string SearchStats::to_json() const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << "{\"depth\":" << depth
+        << ",\"score\":" << score
+        << ",\"threads\":" << threads
+        << ",\"book\":" << (book_hit ? "true" : "false")
+        << ",\"time_ms\":" << time_ms
+        << ",\"nodes\":" << nodes
+        << ",\"qnodes\":" << qnodes
+        << ",\"nps\":" << nps()
+        << ",\"tt_probes\":" << tt_probes
+        << ",\"tt_hits\":" << tt_hits
+        << ",\"tt_cutoffs\":" << tt_cutoffs
+        << ",\"tt_hit_rate\":" << tt_hit_rate()
+        << ",\"beta_cutoffs\":" << beta_cutoffs
+        << ",\"first_move_cutoff_rate\":" << first_move_cutoff_rate()
+        << ",\"branching_factor\":" << branching_factor()
+        << ",\"tb_hits\":" << tb_hits
+        << ",\"iterations\":[";
+    for (size_t i = 0; i < iterations.size(); ++i) {
+        const Iteration& it = iterations[i];
+        out << (i ? "," : "") << "{\"depth\":" << it.depth << ",\"score\":" << it.score
+            << ",\"nodes\":" << it.nodes << ",\"time_ms\":" << it.time_ms << "}";
+    }
+    out << "]}";
+    return out.str();
+}
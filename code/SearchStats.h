@@ -0,0 +1,46 @@
+#ifndef SEARCH_STATS_H
+#define SEARCH_STATS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Counters for one find_best_move call. Every search thread fills its own copy
+// without synchronization; the helpers' copies are merged into the main
+// thread's when the search ends.
+struct SearchStats {
+    struct Iteration {
+        int depth;
+        int score;        // White's view
+        uint64_t nodes;   // Main-thread nodes + qnodes when the iteration finished
+        double time_ms;   // Time spent in this iteration alone
+    };
+
+    uint64_t nodes = 0;              // negamax and root nodes
+    uint64_t qnodes = 0;             // quiescence_search nodes
+    uint64_t tt_probes = 0;
+    uint64_t tt_hits = 0;
+    uint64_t tt_cutoffs = 0;         // Nodes answered straight from the table
+    uint64_t beta_cutoffs = 0;
+    uint64_t first_move_cutoffs = 0; // Cutoffs produced by the first move searched
+    uint64_t interior_nodes = 0;     // Nodes whose moves were searched
+    uint64_t moves_searched = 0;     // Children searched over all interior nodes
+    uint64_t tb_hits = 0;            // Positions answered by the endgame tablebases
+    double time_ms = 0;
+    int depth = 0;                   // Deepest completed iteration
+    int score = 0;                   // Its score, White's view
+    int threads = 1;
+    bool book_hit = false;           // The move came from the opening book; nothing was searched
+    std::vector<Iteration> iterations;
+
+    uint64_t total_nodes() const { return nodes + qnodes; }
+    uint64_t nps() const { return time_ms > 0 ? static_cast<uint64_t>(total_nodes() * 1000.0 / time_ms) : 0; }
+    double tt_hit_rate() const { return tt_probes ? static_cast<double>(tt_hits) / tt_probes : 0.0; }
+    double first_move_cutoff_rate() const { return beta_cutoffs ? static_cast<double>(first_move_cutoffs) / beta_cutoffs : 0.0; }
+    double branching_factor() const { return interior_nodes ? static_cast<double>(moves_searched) / interior_nodes : 0.0; }
+
+    void merge(const SearchStats& other); // Adds another thread's counters
+    std::string to_json() const;          // One line, no trailing newline
+};
+
+#endif // SEARCH_STATS_H
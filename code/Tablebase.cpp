@@ -0,0 +1,235 @@
+#include "Tablebase.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+static const char FILE_MAGIC[8] = {'C', 'Y', 'R', 'U', 'S', 'T', 'B', 0};
+static const unsigned char RUN_LENGTH_BLOCK = 0xFF; // Otherwise the first byte is a palette index width
+
+// Strongest first; the king always leads its side
+static const int TYPE_ORDER[] = {SHAH, RUKH, FARAS, FIL, FERZ, PAWN};
+
+std::string TablebaseMaterial::name() const {
+    std::string name;
+    for (int i = 0; i < count; ++i) {
+        if (i > 0 && piece_type(pieces[i]) == SHAH) name += 'v';
+        name += PIECE_CHARS[make_piece(piece_type(pieces[i]), WHITE)];
+    }
+    return name;
+}
+
+uint64_t TablebaseMaterial::key() const {
+    uint64_t key = 0;
+    for (int i = 0; i < count; ++i) key = key * 13 + pieces[i] + 1;
+    return key;
+}
+
+uint64_t TablebaseMaterial::index(const int squares[], int side_to_move) const {
+    uint64_t index = side_to_move == WHITE ? 0 : 1;
+    for (int i = count - 1; i >= 0; --i) index = (index << 6) | squares[i];
+    return index;
+}
+
+TablebaseMaterial TablebaseMaterial::of(const Bitboards& bb, bool mirrored, int squares[]) {
+    TablebaseMaterial material;
+    for (int color : {WHITE, BLACK}) {
+        int board_color = mirrored ? 1 - color : color;
+        for (int type : TYPE_ORDER) {
+            uint64_t b = bb.of(type, board_color);
+            while (b && material.count < MAX_PIECES) {
+                int sq = pop_lsb(b);
+                squares[material.count] = mirrored ? sq ^ 56 : sq;
+                material.pieces[material.count++] = make_piece(type, color);
+            }
+        }
+    }
+    return material;
+}
+
+std::vector<TablebaseMaterial> TablebaseMaterial::all() {
+    static const int EXTRA[] = {RUKH, FARAS, FIL, FERZ, PAWN};
+    auto make = [](std::vector<int> white, std::vector<int> black) {
+        TablebaseMaterial m;
+        m.pieces[m.count++] = make_piece(SHAH, WHITE);
+        for (int type : white) m.pieces[m.count++] = make_piece(type, WHITE);
+        m.pieces[m.count++] = make_piece(SHAH, BLACK);
+        for (int type : black) m.pieces[m.count++] = make_piece(type, BLACK);
+        return m;
+    };
+
+    std::vector<TablebaseMaterial> tables;
+    for (int i = 0; i < 5; ++i) tables.push_back(make({EXTRA[i]}, {}));
+    for (int i = 0; i < 5; ++i) {
+        for (int j = i; j < 5; ++j) {
+            tables.push_back(make({EXTRA[i], EXTRA[j]}, {}));
+            tables.push_back(make({EXTRA[i]}, {EXTRA[j]}));
+        }
+    }
+    // A capture lowers the piece count and a promotion the pawn count
+    auto rank = [](const TablebaseMaterial& m) {
+        int pawns = 0;
+        for (int i = 0; i < m.count; ++i) pawns += piece_type(m.pieces[i]) == PAWN;
+        return m.count * 8 + pawns;
+    };
+    std::stable_sort(tables.begin(), tables.end(), [&rank](const TablebaseMaterial& a, const TablebaseMaterial& b) {
+        return rank(a) < rank(b);
+    });
+    return tables;
+}
+
+int Tablebases::open(const std::string& directory) {
+    int opened = 0;
+    for (const TablebaseMaterial& material : TablebaseMaterial::all()) {
+        opened += _open_table(directory + "/" + file_name(material), material);
+    }
+    return opened;
+}
+
+bool Tablebases::_open_table(const std::string& path, const TablebaseMaterial& material) {
+    MappedFile mapped;
+    if (!mapped.open(path, MappedFile::READ_ONLY) || mapped.size() < sizeof(FileHeader)) return false;
+    FileHeader header;
+    std::memcpy(&header, mapped.data(), sizeof(header));
+    if (std::memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != FILE_VERSION
+        || header.block_size != BLOCK_SIZE || header.byte_order != BYTE_ORDER_MARK
+        || header.positions != material.size()
+        || header.blocks != (header.positions + BLOCK_SIZE - 1) / BLOCK_SIZE) {
+        return false;
+    }
+    for (int i = 0; i < 8; ++i) {
+        if (header.pieces[i] != (i < material.count ? material.pieces[i] : NO_PIECE)) return false;
+    }
+    size_t data_start = sizeof(FileHeader) + (header.blocks + 1) * sizeof(uint32_t);
+    if (mapped.size() < data_start) return false;
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(mapped.data() + sizeof(FileHeader));
+    if (data_start + offsets[header.blocks] != mapped.size()) return false;
+
+    Table& table = tables[material.key()];
+    table.file = std::move(mapped);
+    table.material = material;
+    table.offsets = reinterpret_cast<const uint32_t*>(table.file.data() + sizeof(FileHeader));
+    table.data = table.file.data() + data_start;
+    return true;
+}
+
+bool Tablebases::probe(const Bitboards& bb, int side_to_move, TablebaseResult& result) const {
+    int count = popcount(bb.occupied);
+    if (count > TablebaseMaterial::MAX_PIECES) return false;
+    if (count == 2) { // Nothing can ever mate
+        result = TablebaseResult();
+        return true;
+    }
+
+    int squares[TablebaseMaterial::MAX_PIECES];
+    bool mirrored = false;
+    auto it = tables.find(TablebaseMaterial::of(bb, false, squares).key());
+    if (it == tables.end()) {
+        mirrored = true;
+        it = tables.find(TablebaseMaterial::of(bb, true, squares).key());
+        if (it == tables.end()) return false;
+    }
+    const Table& table = it->second;
+    uint64_t index = table.material.index(squares, mirrored ? 1 - side_to_move : side_to_move);
+
+    const unsigned char* p = table.data + table.offsets[index / BLOCK_SIZE];
+    uint64_t position = index % BLOCK_SIZE;
+    if (*p != RUN_LENGTH_BLOCK) {
+        // Index width in bits, palette size - 1, the palette, then the indices
+        int bits = *p;
+        const unsigned char* palette = p + 2;
+        const unsigned char* packed = palette + p[1] + 1;
+        uint64_t bit = position * bits;
+        unsigned word = packed[bit / 8] | (packed[bit / 8 + 1] << 8);
+        result = decode(palette[(word >> (bit % 8)) & ((1u << bits) - 1)]);
+        return true;
+    }
+    // Runs are a value byte and a little-endian base-128 length
+    ++p;
+    for (;;) {
+        uint8_t value = *p++;
+        uint64_t run = 0;
+        for (int shift = 0;; shift += 7) {
+            run |= static_cast<uint64_t>(*p & 0x7F) << shift;
+            if (!(*p++ & 0x80)) break;
+        }
+        if (position < run) {
+            result = decode(value);
+            return true;
+        }
+        position -= run;
+    }
+}
+
+TablebaseResult Tablebases::decode(uint8_t value) {
+    TablebaseResult result;
+    if (value == 0) return result;
+    result.dtm = value - 1;
+    result.wdl = (result.dtm & 1) ? 1 : -1;
+    return result;
+}
+
+bool Tablebases::write(const std::string& path, const TablebaseMaterial& material, const std::vector<uint8_t>& values) {
+    if (values.size() != material.size()) return false;
+    FileHeader header = {};
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+    header.version = FILE_VERSION;
+    header.block_size = BLOCK_SIZE;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.positions = values.size();
+    header.blocks = static_cast<uint32_t>((values.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    for (int i = 0; i < 8; ++i) header.pieces[i] = static_cast<int8_t>(i < material.count ? material.pieces[i] : NO_PIECE);
+
+    std::vector<uint32_t> offsets;
+    std::vector<unsigned char> data;
+    for (size_t start = 0; start < values.size(); start += BLOCK_SIZE) {
+        offsets.push_back(static_cast<uint32_t>(data.size()));
+        size_t end = std::min(start + BLOCK_SIZE, values.size());
+        for (size_t i = start; i < end; ++i) {
+            header.max_dtm = std::max<uint32_t>(header.max_dtm, values[i] ? values[i] - 1u : 0u);
+        }
+
+        std::vector<unsigned char> runs = {RUN_LENGTH_BLOCK};
+        for (size_t i = start; i < end;) {
+            size_t run = 1;
+            while (i + run < end && values[i + run] == values[i]) ++run;
+            runs.push_back(values[i]);
+            for (size_t n = run; ; n >>= 7) {
+                runs.push_back(static_cast<unsigned char>((n & 0x7F) | (n > 0x7F ? 0x80 : 0)));
+                if (n <= 0x7F) break;
+            }
+            i += run;
+        }
+
+        int slot[256];
+        std::fill(slot, slot + 256, -1);
+        std::vector<unsigned char> palette;
+        for (size_t i = start; i < end; ++i) {
+            if (slot[values[i]] < 0) {
+                slot[values[i]] = static_cast<int>(palette.size());
+                palette.push_back(values[i]);
+            }
+        }
+        int bits = 0;
+        while ((1u << bits) < palette.size()) ++bits;
+        std::vector<unsigned char> packed = {static_cast<unsigned char>(bits), static_cast<unsigned char>(palette.size() - 1)};
+        packed.insert(packed.end(), palette.begin(), palette.end());
+        size_t first = packed.size();
+        packed.resize(first + ((end - start) * bits + 7) / 8 + 1); // A spare byte for two-byte reads
+        for (size_t i = start; i < end; ++i) {
+            uint64_t bit = (i - start) * bits;
+            unsigned shifted = static_cast<unsigned>(slot[values[i]]) << (bit % 8);
+            packed[first + bit / 8] |= static_cast<unsigned char>(shifted);
+            packed[first + bit / 8 + 1] |= static_cast<unsigned char>(shifted >> 8);
+        }
+
+        const auto& smaller = runs.size() <= packed.size() ? runs : packed;
+        data.insert(data.end(), smaller.begin(), smaller.end());
+    }
+    offsets.push_back(static_cast<uint32_t>(data.size()));
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(offsets.data()), static_cast<std::streamsize>(offsets.size() * sizeof(uint32_t)));
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,93 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "Bitboard.h"
+#include "MappedFile.h"
+
+// Endgame tablebases: the exact result and distance to mate of every position
+// with at most four pieces, kings included, as built by cyrus-tbgen. They
+// follow the engine's rules rather than the historical ones: checkmate loses,
+// stalemate and bare kings are draws.
+
+struct TablebaseResult {
+    int wdl = 0; // 1 win, 0 draw, -1 loss, for the side to move
+    int dtm = 0; // Plies to mate with best play by both sides, 0 for a draw
+};
+
+// The pieces of one table in index order: White's king, then its other pieces
+// strongest first (Rukh, Faras, Fil, Ferz, pawn), then Black's the same way.
+// Every table has the stronger side as White; positions with the colors
+// reversed are probed mirrored top to bottom.
+struct TablebaseMaterial {
+    static const int MAX_PIECES = 4;
+    int count = 0;
+    int pieces[MAX_PIECES] = {};
+
+    std::string name() const; // e.g. "KRvKQ", letters as in FEN
+    uint64_t key() const;
+    uint64_t size() const { return 2ULL << (6 * count); } // Positions, both sides to move
+    // Squares in piece order. White to move fills the first half of the table.
+    uint64_t index(const int squares[], int side_to_move) const;
+
+    // The material on a board and the squares in piece order; `mirrored` swaps
+    // the colors and flips the board, for a table with the other side as White.
+    static TablebaseMaterial of(const Bitboards& bb, bool mirrored, int squares[]);
+    // Every table, ordered so that captures and promotions only lead to earlier
+    // ones (or to bare kings)
+    static std::vector<TablebaseMaterial> all();
+};
+
+// Read-only set of tables, each memory-mapped. A file holds one byte per
+// position, 0 for a draw and otherwise the distance to mate plus one, coded in
+// blocks of BLOCK_SIZE positions with an offset for each block. A block is
+// either run-length coded, when a probe walks its runs, or a palette of the
+// values it uses followed by one fixed-width palette index per position,
+// whichever is smaller.
+class Tablebases {
+public:
+    int open(const std::string& directory); // Maps every table found there; returns how many
+    size_t size() const { return tables.size(); }
+
+    // False unless the position is covered: two kings only, or a loaded table.
+    // Safe to call from any number of threads.
+    bool probe(const Bitboards& bb, int side_to_move, TablebaseResult& result) const;
+
+    // Stored byte <-> result. Odd distances are wins for the side to move.
+    static TablebaseResult decode(uint8_t value);
+    static std::string file_name(const TablebaseMaterial& material) { return material.name() + ".ctb"; }
+    // Compresses one byte per position, in index order, into a table file
+    static bool write(const std::string& path, const TablebaseMaterial& material, const std::vector<uint8_t>& values);
+
+    static const uint32_t BLOCK_SIZE = 2048;
+
+private:
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t block_size;
+        uint64_t byte_order;
+        uint64_t positions;
+        uint32_t blocks;
+        uint32_t max_dtm;
+        int8_t pieces[8];    // NO_PIECE past the last
+        uint64_t reserved[2];
+    };
+    static_assert(sizeof(FileHeader) == 64, "tablebase header should keep the block offsets aligned");
+    static const uint32_t FILE_VERSION = 1;
+    static const uint64_t BYTE_ORDER_MARK = 0x0102030405060708ULL;
+
+    struct Table {
+        MappedFile file;
+        TablebaseMaterial material;
+        const uint32_t* offsets = nullptr; // blocks + 1 entries, relative to `data`
+        const unsigned char* data = nullptr;
+    };
+    bool _open_table(const std::string& path, const TablebaseMaterial& material);
+    std::unordered_map<uint64_t, Table> tables; // By TablebaseMaterial::key
+};
+
+#endif // TABLEBASE_H
@@ -0,0 +1,76 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threads) {
+    int count = std::max(threads, 1);
+    for (int i = 0; i < count; ++i) workers.emplace_back(new Worker);
+    for (int i = 0; i < count; ++i) this->threads.emplace_back(&ThreadPool::_run, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : threads) t.join();
+}
+
+void ThreadPool::submit(Task task) {
+    Worker& worker = *workers[next_worker.fetch_add(1, std::memory_order_relaxed) % workers.size()];
+    unfinished.fetch_add(1);
+    {
+        // Counted before it is queued, so the count never goes below zero, and
+        // under the sleep lock, so a worker about to sleep sees it
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        queued.fetch_add(1);
+    }
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    wake.notify_one();
+}
+
+void ThreadPool::wait_idle() {
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    idle.wait(lock, [this] { return unfinished.load() == 0; });
+}
+
+bool ThreadPool::_take(int index, Task& task) {
+    // Own queue from the front, then the back of the others starting with the next one
+    int count = size();
+    for (int i = 0; i < count; ++i) {
+        Worker& worker = *workers[(index + i) % count];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty()) continue;
+        if (i == 0) {
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+        } else {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+        }
+        queued.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::_run(int index) {
+    Task task;
+    for (;;) {
+        if (_take(index, task)) {
+            task(index);
+            task = nullptr;
+            if (unfinished.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                idle.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) return;
+    }
+}
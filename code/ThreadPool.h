@@ -0,0 +1,54 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads, each with its own task queue. submit() deals
+// tasks out round-robin; a worker runs its own queue oldest first and, once
+// that is empty, steals the newest task of another worker, so one slow task
+// does not hold up the ones queued behind it.
+//
+// Tasks get the index of the worker running them, so a caller can keep
+// per-worker state (an engine, scratch buffers) without locking.
+class ThreadPool {
+public:
+    using Task = std::function<void(int worker)>;
+
+    explicit ThreadPool(int threads);
+    ~ThreadPool(); // Runs every queued task, then joins the workers
+
+    void submit(Task task);
+    void wait_idle(); // Until every submitted task has finished
+    int size() const { return static_cast<int>(workers.size()); }
+    size_t pending() const { return queued.load(std::memory_order_relaxed); } // Submitted, not yet started
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void _run(int index);
+    bool _take(int index, Task& task);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> next_worker{0};
+    std::atomic<size_t> queued{0};
+    std::atomic<size_t> unfinished{0};
+
+    // Idle workers sleep here until a task arrives or the pool shuts down
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    bool stopping = false;
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,181 @@
+#include "TrainingData.h"
+#include <cstring>
+#include <algorithm>
+
+static const char FILE_MAGIC[8] = {'C', 'Y', 'R', 'U', 'S', 'T', 'D', 0};
+static const uint32_t FILE_VERSION = 1;
+static const uint64_t BYTE_ORDER_MARK = 0x0102030405060708ULL;
+static const size_t RECORD_SIZE = sizeof(TrainingRecord);
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t byte_order;
+    uint32_t block_records;
+    uint32_t reserved;
+};
+static_assert(sizeof(FileHeader) == 32, "training file header is written as it sits in memory");
+
+struct BlockHeader {
+    uint32_t records;
+    uint32_t bytes; // Compressed size of what follows
+};
+
+TrainingRecord TrainingRecord::from(const Bitboards& bb, int side_to_move, int score, int ply) {
+    TrainingRecord record = {};
+    record.occupied = bb.occupied;
+    int n = 0;
+    for (uint64_t b = bb.occupied; b && n < 32; ++n) {
+        record.pieces[n / 2] |= static_cast<uint8_t>(bb.piece_on(pop_lsb(b)) << (n % 2 * 4));
+    }
+    record.score = static_cast<int16_t>(std::min(std::max(score, -32767), 32767));
+    record.side_to_move = static_cast<uint8_t>(side_to_move);
+    record.ply = static_cast<uint16_t>(std::min(ply, 65535));
+    return record;
+}
+
+Bitboards TrainingRecord::board() const {
+    Bitboards bb;
+    bb.clear();
+    int n = 0;
+    for (uint64_t b = occupied; b && n < 32; ++n) {
+        bb.put(pieces[n / 2] >> (n % 2 * 4) & 15, pop_lsb(b));
+    }
+    return bb;
+}
+
+bool TrainingWriter::open(const std::string& path) {
+    close();
+    out.open(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    FileHeader header = {};
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+    header.version = FILE_VERSION;
+    header.record_size = RECORD_SIZE;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.block_records = BLOCK_RECORDS;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    written = 0;
+    file_bytes = sizeof(header);
+    block.clear();
+    block.reserve(BLOCK_RECORDS);
+    return static_cast<bool>(out);
+}
+
+bool TrainingWriter::write(const TrainingRecord& record) {
+    block.push_back(record);
+    ++written;
+    return block.size() < BLOCK_RECORDS || _flush();
+}
+
+bool TrainingWriter::close() {
+    if (!out.is_open()) return true;
+    bool ok = _flush();
+    out.close();
+    return ok && !out.fail();
+}
+
+bool TrainingWriter::_flush() {
+    if (block.empty()) return static_cast<bool>(out);
+    size_t n = block.size();
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(block.data());
+
+    buffer.clear();
+    size_t zeros = 0;
+    auto end_run = [this, &zeros]() {
+        if (!zeros) return;
+        buffer.push_back(0);
+        for (size_t run = zeros; ; run >>= 7) {
+            buffer.push_back(static_cast<unsigned char>((run & 0x7F) | (run > 0x7F ? 0x80 : 0)));
+            if (run <= 0x7F) break;
+        }
+        zeros = 0;
+    };
+    for (size_t column = 0; column < RECORD_SIZE; ++column) {
+        for (size_t i = 0; i < n; ++i) {
+            unsigned char delta = bytes[i * RECORD_SIZE + column] ^ (i ? bytes[(i - 1) * RECORD_SIZE + column] : 0);
+            if (delta == 0) {
+                ++zeros;
+                continue;
+            }
+            end_run();
+            buffer.push_back(delta);
+        }
+    }
+    end_run();
+
+    BlockHeader header = {static_cast<uint32_t>(n), static_cast<uint32_t>(buffer.size())};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    out.flush();
+    file_bytes += sizeof(header) + buffer.size();
+    block.clear();
+    return static_cast<bool>(out);
+}
+
+bool TrainingReader::open(const std::string& path) {
+    in.close();
+    in.clear();
+    block.clear();
+    position = 0;
+    in.open(path, std::ios::binary);
+    FileHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    return std::memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) == 0 && header.version == FILE_VERSION
+        && header.record_size == RECORD_SIZE && header.byte_order == BYTE_ORDER_MARK;
+}
+
+bool TrainingReader::read_block(std::vector<TrainingRecord>& records) {
+    BlockHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.records == 0
+        || header.records > TrainingWriter::BLOCK_RECORDS || header.bytes > header.records * RECORD_SIZE * 2) {
+        return false;
+    }
+    buffer.resize(header.bytes);
+    if (!in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()))) return false;
+
+    // Undo the run-length coding into column order, then the columns and the XOR
+    size_t n = header.records, total = n * RECORD_SIZE;
+    std::vector<unsigned char> columns(total, 0);
+    size_t out = 0;
+    for (size_t i = 0; i < buffer.size();) {
+        unsigned char byte = buffer[i++];
+        if (byte != 0) {
+            if (out >= total) return false;
+            columns[out++] = byte;
+            continue;
+        }
+        size_t run = 0;
+        for (int shift = 0; ; shift += 7) {
+            if (i >= buffer.size() || shift > 28) return false;
+            unsigned char part = buffer[i++];
+            run |= static_cast<size_t>(part & 0x7F) << shift;
+            if (!(part & 0x80)) break;
+        }
+        if (run > total - out) return false;
+        out += run; // Already zero
+    }
+    if (out != total) return false;
+
+    size_t first = records.size();
+    records.resize(first + n);
+    unsigned char* bytes = reinterpret_cast<unsigned char*>(records.data() + first);
+    for (size_t column = 0; column < RECORD_SIZE; ++column) {
+        for (size_t i = 0; i < n; ++i) {
+            unsigned char delta = columns[column * n + i];
+            bytes[i * RECORD_SIZE + column] = delta ^ (i ? bytes[(i - 1) * RECORD_SIZE + column] : 0);
+        }
+    }
+    return true;
+}
+
+bool TrainingReader::next(TrainingRecord& record) {
+    if (position == block.size()) {
+        block.clear();
+        position = 0;
+        if (!read_block(block)) return false;
+    }
+    record = block[position++];
+    return true;
+}
@@ -0,0 +1,70 @@
+#ifndef TRAINING_DATA_H
+#define TRAINING_DATA_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fstream>
+#include "Bitboard.h"
+
+// One scored position from a self-play game, as written by cyrus-datagen and
+// read by cyrus-tune. A Shatranj position never has more than 32 pieces, so
+// the board fits in the occupied squares plus one 4-bit piece index each.
+struct TrainingRecord {
+    uint64_t occupied;
+    uint8_t pieces[16];   // Piece on each occupied square in square order, two per byte, low nibble first
+    int16_t score;        // Search score, White's view
+    int8_t result;        // Game result, White's view: 1 win, 0 draw, -1 loss
+    uint8_t side_to_move; // WHITE or BLACK
+    uint16_t ply;         // Plies since the start position
+    uint16_t reserved;
+
+    static TrainingRecord from(const Bitboards& bb, int side_to_move, int score, int ply);
+    Bitboards board() const;
+};
+static_assert(sizeof(TrainingRecord) == 32, "records are compressed as they sit in memory");
+
+// A stream of records: a 32-byte header, then blocks of up to BLOCK_RECORDS
+// records, each compressed on its own. Within a block every record is XORed
+// with the one before it, so consecutive positions of a game leave mostly
+// zeros; the bytes are then stored column by column (every record's first
+// byte, then every second byte, ...) and zero runs are run-length coded.
+// Nothing is indexed, so a file can be written and read as a stream, and a
+// writer that is killed loses at most the block it was filling.
+class TrainingWriter {
+public:
+    static const uint32_t BLOCK_RECORDS = 4096;
+
+    ~TrainingWriter() { close(); }
+    bool open(const std::string& path); // Truncates; false if the file cannot be created
+    bool write(const TrainingRecord& record);
+    bool close(); // Writes the last, partial block; false if any write failed
+    uint64_t records() const { return written; }
+    uint64_t bytes() const { return file_bytes; }
+
+private:
+    bool _flush();
+
+    std::ofstream out;
+    std::vector<TrainingRecord> block;
+    std::vector<unsigned char> buffer;
+    uint64_t written = 0;
+    uint64_t file_bytes = 0;
+};
+
+class TrainingReader {
+public:
+    bool open(const std::string& path); // False if missing or not a training file of this version
+    // Appends the next block to `records`; false at the end of the stream or a
+    // truncated or corrupt block
+    bool read_block(std::vector<TrainingRecord>& records);
+    bool next(TrainingRecord& record); // One record at a time
+
+private:
+    std::ifstream in;
+    std::vector<unsigned char> buffer;
+    std::vector<TrainingRecord> block;
+    size_t position = 0; // Next record of `block` for next()
+};
+
+#endif // TRAINING_DATA_H
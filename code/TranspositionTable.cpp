@@ -0,0 +1,134 @@
+#include "TranspositionTable.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+static const char FILE_MAGIC[8] = {'C', 'Y', 'R', 'U', 'S', 'T', 'T', 0};
+
+TranspositionTable::TranspositionTable(size_t megabytes) {
+    resize(megabytes);
+}
+
+void TranspositionTable::resize(size_t megabytes) {
+    size_t budget = std::max<size_t>(megabytes, 1) * 1024 * 1024;
+    size_t count = 1;
+    while (count * 2 * sizeof(Bucket) <= budget) {
+        count *= 2;
+    }
+    mapping.close();
+    storage.reset();
+    buckets = nullptr;
+    bucket_count = count;
+    generation = 0;
+}
+
+void TranspositionTable::new_search() {
+    if (!buckets) {
+        storage.reset(new Bucket[bucket_count]);
+        buckets = storage.get();
+        clear();
+    }
+    generation.store((current_generation() + 1) & GENERATION_MASK, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear() {
+    for (size_t i = 0; buckets && i < bucket_count; ++i) {
+        for (Entry& e : buckets[i].entries) {
+            e.key_xor_data.store(0, std::memory_order_relaxed);
+            e.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    generation = 0;
+}
+
+bool TranspositionTable::probe(uint64_t key, TT_Entry& out) const {
+    const Bucket& b = buckets[key & (bucket_count - 1)];
+    for (const Entry& e : b.entries) {
+        uint64_t d = e.data.load(std::memory_order_relaxed);
+        if ((e.key_xor_data.load(std::memory_order_relaxed) ^ d) == key && data_bound(d) != 0) {
+            out.depth = data_depth(d);
+            out.score = data_score(d);
+            out.flag = static_cast<TT_Flag>(data_bound(d) - 1);
+            out.move = data_move(d);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, int score, TT_Flag flag, uint16_t move) {
+    Bucket& b = bucket_for(key);
+
+    // Reuse this position's slot if present, else an empty one, else the
+    // shallowest entry, counting entries from older searches as shallower.
+    Entry* replace = &b.entries[0];
+    uint64_t replace_data = replace->data.load(std::memory_order_relaxed);
+    for (Entry& e : b.entries) {
+        uint64_t d = e.data.load(std::memory_order_relaxed);
+        bool same_key = (e.key_xor_data.load(std::memory_order_relaxed) ^ d) == key;
+        if (same_key || data_bound(d) == 0) {
+            replace = &e;
+            replace_data = d;
+            if (same_key && move == 0) move = data_move(d); // Keep the old best move rather than erase it
+            break;
+        }
+        if (data_depth(d) - 2 * age(d) < data_depth(replace_data) - 2 * age(replace_data)) {
+            replace = &e;
+            replace_data = d;
+        }
+    }
+
+    uint64_t d = pack(std::min(std::max(depth, 0), 255), score, flag, move, current_generation());
+    replace->key_xor_data.store(key ^ d, std::memory_order_relaxed);
+    replace->data.store(d, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const {
+    size_t sample = buckets ? std::min<size_t>(bucket_count, 250) : 0;
+    int used = 0, total = 0;
+    for (size_t i = 0; i < sample; ++i) {
+        for (const Entry& e : buckets[i].entries) {
+            uint64_t d = e.data.load(std::memory_order_relaxed);
+            used += data_bound(d) != 0 && data_generation(d) == current_generation();
+            ++total;
+        }
+    }
+    return total ? used * 1000 / total : 0;
+}
+
+bool TranspositionTable::save(const std::string& path) const {
+    if (!buckets) return false;
+    FileHeader header = {};
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+    header.version = FILE_VERSION;
+    header.bucket_size = sizeof(Bucket);
+    header.byte_order = BYTE_ORDER_MARK;
+    header.bucket_count = bucket_count;
+    header.generation = static_cast<uint8_t>(current_generation());
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(buckets), static_cast<std::streamsize>(size_bytes()));
+    return static_cast<bool>(out);
+}
+
+bool TranspositionTable::load(const std::string& path) {
+    MappedFile file;
+    if (!file.open(path, MappedFile::COPY_ON_WRITE) || file.size() < sizeof(FileHeader)) return false;
+    FileHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    uint64_t count = header.bucket_count;
+    if (std::memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != FILE_VERSION
+        || header.bucket_size != sizeof(Bucket) || header.byte_order != BYTE_ORDER_MARK
+        || count == 0 || (count & (count - 1)) != 0 || file.size() != sizeof(FileHeader) + count * sizeof(Bucket)) {
+        return false;
+    }
+
+    storage.reset();
+    mapping = std::move(file);
+    buckets = reinterpret_cast<Bucket*>(mapping.mutable_data() + sizeof(FileHeader));
+    bucket_count = count;
+    generation = header.generation & GENERATION_MASK;
+    return true;
+}
@@ -0,0 +1,110 @@
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <string>
+#include "MappedFile.h"
+
+enum TT_Flag { TT_EXACT, TT_LOWER, TT_UPPER };
+
+// Unpacked result of a probe. Moves are packed as from | to << 6, 0 for none.
+struct TT_Entry {
+    int depth;
+    int score;
+    TT_Flag flag;
+    uint16_t move;
+};
+
+// Fixed-size, preallocated transposition table. Buckets are one cache line
+// holding four 16-byte entries, so a probe touches a single line of memory.
+//
+// The table is shared by all search threads without locks. Each entry is two
+// 64-bit words, the packed data and the key XOR the data, written and read with
+// relaxed atomics; an entry torn by a concurrent write fails the XOR check on
+// probe and reads as a miss.
+//
+// save() writes the buckets as they sit in memory behind a 64-byte header, so
+// load() can map the file straight back in: pages are read on first touch and
+// copied on first write, and the file itself is never modified.
+//
+// Memory is only allocated by the first new_search(), so engines that never
+// search, or are resized before searching, cost nothing.
+class TranspositionTable {
+public:
+    explicit TranspositionTable(size_t megabytes = 16);
+
+    // Sizes the table to the largest power-of-two bucket count fitting the
+    // budget and frees the current one; the next search starts empty.
+    void resize(size_t megabytes);
+    void clear();
+    // Starts a new search: entries from older searches become preferred replacement victims.
+    // Call only while no search is running, except on a table shared by
+    // independent searches (see CyrusEngine::share_hash): once allocated, its
+    // owner may age it at any time.
+    void new_search();
+
+    // Call only while no search is running. save() fails if no search has
+    // allocated the table yet. load() adopts the saved size; on failure it
+    // returns false and leaves the table as it was.
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    bool probe(uint64_t key, TT_Entry& out) const;
+    void store(uint64_t key, int depth, int score, TT_Flag flag, uint16_t move);
+
+    size_t size_bytes() const { return bucket_count * sizeof(Bucket); } // Once allocated
+    int hashfull() const; // Permille of sampled entries written during the current search
+
+private:
+    // Data word layout: score (32 bits) | move (16) | depth (8) | generation (6) | TT_Flag + 1 (2, 0 = empty)
+    struct Entry {
+        std::atomic<uint64_t> key_xor_data;
+        std::atomic<uint64_t> data;
+    };
+
+    static uint64_t pack(int depth, int score, TT_Flag flag, uint16_t move, int generation) {
+        return static_cast<uint64_t>(static_cast<uint32_t>(score)) << 32 | static_cast<uint64_t>(move) << 16
+             | static_cast<uint64_t>(depth) << 8 | static_cast<uint64_t>(generation) << 2 | (flag + 1);
+    }
+    static int data_score(uint64_t d) { return static_cast<int32_t>(d >> 32); }
+    static uint16_t data_move(uint64_t d) { return static_cast<uint16_t>(d >> 16); }
+    static int data_depth(uint64_t d) { return (d >> 8) & 0xFF; }
+    static int data_generation(uint64_t d) { return (d >> 2) & GENERATION_MASK; }
+    static int data_bound(uint64_t d) { return d & 3; } // TT_Flag + 1, 0 for an empty slot
+
+    static const int ENTRIES_PER_BUCKET = 4;
+    static const int GENERATION_MASK = 63;
+
+    struct alignas(64) Bucket {
+        Entry entries[ENTRIES_PER_BUCKET];
+    };
+    static_assert(sizeof(Bucket) == 64, "TT bucket should fill one cache line");
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t bucket_size;
+        uint64_t byte_order;  // BYTE_ORDER_MARK as written by the saving machine
+        uint64_t bucket_count;
+        uint8_t generation;
+        uint8_t reserved[31];
+    };
+    static_assert(sizeof(FileHeader) == 64, "TT file header should keep the buckets cache-line aligned");
+    static const uint32_t FILE_VERSION = 3; // 2: compile-time Zobrist keys, 3: mate scores relative to the entry
+    static const uint64_t BYTE_ORDER_MARK = 0x0102030405060708ULL;
+
+    Bucket& bucket_for(uint64_t key) { return buckets[key & (bucket_count - 1)]; }
+    int current_generation() const { return generation.load(std::memory_order_relaxed); }
+    int age(uint64_t d) const { return (current_generation() - data_generation(d)) & GENERATION_MASK; }
+
+    Bucket* buckets = nullptr;          // Points into storage or mapping, null until the first search
+    std::unique_ptr<Bucket[]> storage;
+    MappedFile mapping;                 // Set while the table lives in a loaded file
+    size_t bucket_count = 0;
+    std::atomic<uint8_t> generation{0};
+};
+
+#endif // TRANSPOSITION_TABLE_H
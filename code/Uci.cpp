@@ -0,0 +1,224 @@
+#include "Uci.h"
+#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+
+// Time kept back for process and GUI latency on every move
+static const int64_t MOVE_OVERHEAD_MS = 30;
+
+static std::string format_score(int score) {
+    if (!CyrusEngine::is_mate_score(score)) return "cp " + std::to_string(score);
+    // Mate scores fall by one per ply to the mate; UCI counts moves
+    int moves = (CyrusEngine::MATE_SCORE - std::abs(score) + 1) / 2;
+    return "mate " + std::to_string(score > 0 ? moves : -moves);
+}
+
+UciProtocol::UciProtocol(std::istream& in, std::ostream& out) : in(in), out(out) {
+    engine.on_iteration = [this](const SearchInfo& info) { _report(info); };
+}
+
+UciProtocol::~UciProtocol() {
+    _stop_search();
+}
+
+void UciProtocol::run() {
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!execute(line)) return;
+    }
+    _stop_search();
+}
+
+bool UciProtocol::execute(const std::string& line) {
+    std::istringstream args(line);
+    std::string command;
+    args >> command;
+
+    if (command == "uci") {
+        _send("id name Cyrus 1.1.0");
+        _send("id author Tonmoy-KS");
+        _send("option name Hash type spin default 16 min 1 max 65536");
+        _send("option name Threads type spin default 1 min 1 max 256");
+        _send("option name Ponder type check default false");
+        _send("option name BookFile type string default <empty>");
+        _send("option name TablebasePath type string default <empty>");
+        _send("option name EvalFile type string default <empty>");
+        _send("uciok");
+    } else if (command == "isready") {
+        _send("readyok");
+    } else if (command == "setoption") {
+        _stop_search();
+        _set_option(args);
+    } else if (command == "ucinewgame") {
+        _stop_search();
+        engine.new_game();
+    } else if (command == "position") {
+        _stop_search();
+        _position(args);
+    } else if (command == "go") {
+        _stop_search();
+        _go(args);
+    } else if (command == "stop") {
+        _stop_search();
+    } else if (command == "ponderhit") {
+        {
+            std::lock_guard<std::mutex> lock(wait_mutex);
+            pondering = false;
+        }
+        released.notify_all();
+    } else if (command == "quit") {
+        _stop_search();
+        return false;
+    } else if (!command.empty()) {
+        _send("info string unknown command " + command);
+    }
+    return true;
+}
+
+void UciProtocol::_send(const std::string& line) {
+    std::lock_guard<std::mutex> lock(out_mutex);
+    out << line << std::endl;
+}
+
+void UciProtocol::_set_option(std::istringstream& args) {
+    // setoption name <name> [value <value>]; names may contain spaces
+    std::string token, name, value;
+    args >> token;
+    while (args >> token && token != "value") name += (name.empty() ? "" : " ") + token;
+    std::getline(args >> std::ws, value);
+
+    if (name == "Hash") engine.set_hash_size(std::max(1, std::atoi(value.c_str())));
+    else if (name == "Threads") engine.search_threads = std::max(1, std::atoi(value.c_str()));
+    else if (name == "Ponder") {} // Pondering is driven by "go ponder"; nothing to configure
+    else if (name == "BookFile") {
+        engine.book.reset();
+        if (value.empty() || value == "<empty>") return;
+        auto book = std::make_shared<OpeningBook>();
+        if (book->open(value)) engine.book = book;
+        else _send("info string cannot open book " + value);
+    }
+    else if (name == "TablebasePath") {
+        engine.tablebases.reset();
+        if (value.empty() || value == "<empty>") return;
+        auto tablebases = std::make_shared<Tablebases>();
+        int found = tablebases->open(value);
+        _send("info string found " + std::to_string(found) + " tablebases in " + value);
+        if (found) engine.tablebases = tablebases;
+    }
+    else if (name == "EvalFile") {
+        engine.network.reset();
+        if (value.empty() || value == "<empty>") return;
+        auto network = std::make_shared<NnueNetwork>();
+        if (network->open(value)) {
+            engine.network = network;
+            _send(std::string("info string using network ") + value + " with " + NnueNetwork::kernels() + " kernels");
+        }
+        else _send("info string cannot open network " + value);
+    }
+    else _send("info string unknown option " + name);
+}
+
+void UciProtocol::_position(std::istringstream& args) {
+    std::string token, fen;
+    args >> token;
+    if (token == "startpos") {
+        fen = START_FEN;
+        args >> token;
+    } else if (token == "fen") {
+        while (args >> token && token != "moves") fen += (fen.empty() ? "" : " ") + token;
+    } else {
+        return;
+    }
+    if (!engine.set_fen(fen)) {
+        _send("info string invalid fen " + fen);
+        return;
+    }
+
+    // Remaining tokens, after "moves", are played in order
+    while (args >> token) {
+        auto legal = engine.get_all_legal_moves(engine.current_turn());
+        auto it = std::find_if(legal.begin(), legal.end(), [&token](const Move& m) { return format_move(m) == token; });
+        if (it == legal.end()) {
+            _send("info string illegal move " + token);
+            return;
+        }
+        engine.make_move(*it);
+    }
+}
+
+void UciProtocol::_go(std::istringstream& args) {
+    SearchLimits limits;
+    int64_t time_left[2] = {0, 0}, increment[2] = {0, 0}, moves_to_go = 0, move_time = 0;
+    infinite = false;
+    pondering = false;
+
+    std::string token;
+    while (args >> token) {
+        if (token == "wtime") args >> time_left[WHITE];
+        else if (token == "btime") args >> time_left[BLACK];
+        else if (token == "winc") args >> increment[WHITE];
+        else if (token == "binc") args >> increment[BLACK];
+        else if (token == "movestogo") args >> moves_to_go;
+        else if (token == "movetime") args >> move_time;
+        else if (token == "depth") args >> limits.depth;
+        else if (token == "nodes") args >> limits.nodes;
+        else if (token == "infinite") infinite = true;
+        else if (token == "ponder") pondering = true;
+    }
+
+    int us = engine.current_turn() == 'w' ? WHITE : BLACK;
+    if (move_time > 0) {
+        limits.soft_time_ms = limits.hard_time_ms = std::max<int64_t>(move_time - MOVE_OVERHEAD_MS, 1);
+    } else if (time_left[us] > 0) {
+        // Aim to finish around time / moves-to-go plus most of the increment:
+        // no iteration starts past half of that, and none runs past three times
+        // it or a third of the clock.
+        int64_t usable = std::max<int64_t>(time_left[us] - MOVE_OVERHEAD_MS, 1);
+        int64_t budget = usable / (moves_to_go > 0 ? moves_to_go : 30) + increment[us] * 3 / 4;
+        limits.soft_time_ms = std::max<int64_t>(budget / 2, 1);
+        limits.hard_time_ms = std::max<int64_t>(std::min(budget * 3, usable / 3), 1);
+    }
+    limits.infinite = infinite;
+    limits.stop_on_mate = !infinite;
+    limits.stop = &stop;
+    if (pondering) limits.ponder = &pondering;
+
+    stop = false;
+    last_pv.clear();
+    worker = std::thread(&UciProtocol::_search, this, limits);
+}
+
+void UciProtocol::_search(SearchLimits limits) {
+    Move best = engine.find_best_move(engine.current_turn(), limits);
+
+    // After go infinite or go ponder, bestmove may only follow stop or ponderhit
+    {
+        std::unique_lock<std::mutex> lock(wait_mutex);
+        released.wait(lock, [this] { return stop || (!infinite && !pondering); });
+    }
+
+    std::string line = "bestmove " + (best.from == -1 ? std::string("0000") : format_move(best));
+    if (last_pv.size() > 1 && last_pv[0] == best) line += " ponder " + format_move(last_pv[1]);
+    _send(line);
+}
+
+void UciProtocol::_stop_search() {
+    if (!worker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        stop = true;
+    }
+    released.notify_all();
+    worker.join();
+}
+
+void UciProtocol::_report(const SearchInfo& info) {
+    last_pv = info.pv;
+    std::ostringstream line;
+    uint64_t time = static_cast<uint64_t>(info.time_ms);
+    line << "info depth " << info.depth << " score " << format_score(info.score)
+         << " nodes " << info.nodes << " nps " << static_cast<uint64_t>(info.time_ms > 0 ? info.nodes * 1000.0 / info.time_ms : 0)
+         << " time " << time << " hashfull " << info.hashfull << " pv";
+    for (const auto& move : info.pv) line << " " << format_move(move);
+    _send(line.str());
+}
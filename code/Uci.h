@@ -0,0 +1,55 @@
+#ifndef UCI_H
+#define UCI_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "Cyrus.h"
+
+// UCI-style protocol front end. Positions are given in Shatranj FEN (see
+// CyrusEngine::set_fen) or as "startpos", moves in coordinate notation.
+//
+// Supported: uci, isready, setoption (Hash, Threads, Ponder, BookFile), ucinewgame,
+// position, go (wtime btime winc binc movestogo depth nodes movetime infinite
+// ponder), stop, ponderhit, quit. Searches run on a worker thread and stream
+// an info line per iteration, so stop and ponderhit are handled while the
+// engine thinks. After "go infinite" or "go ponder" the bestmove line waits
+// for stop or ponderhit, as the protocol requires.
+class UciProtocol {
+public:
+    UciProtocol(std::istream& in = std::cin, std::ostream& out = std::cout);
+    ~UciProtocol();
+
+    void run();                             // Reads commands until quit or end of input
+    bool execute(const std::string& line);  // Handles one command; false after quit
+
+private:
+    void _send(const std::string& line);
+    void _go(std::istringstream& args);
+    void _position(std::istringstream& args);
+    void _set_option(std::istringstream& args);
+    void _search(SearchLimits limits);
+    void _stop_search(); // Stops any running search and waits for its bestmove
+    void _report(const SearchInfo& info);
+
+    std::istream& in;
+    std::ostream& out;
+    CyrusEngine engine;
+    std::thread worker;
+    std::mutex out_mutex;
+
+    // Raised by stop/ponderhit; the worker waits on them before bestmove
+    std::mutex wait_mutex;
+    std::condition_variable released;
+    std::atomic<bool> stop{false};
+    std::atomic<bool> pondering{false};
+    bool infinite = false;
+
+    std::vector<Move> last_pv; // From the latest iteration; written by the worker only
+};
+
+#endif // UCI_H
@@ -0,0 +1,49 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstdint>
+#include "Bitboard.h"
+
+// Zobrist keys, generated at compile time with splitmix64 from a fixed seed, so
+// every build and every engine hashes a position the same way. Saved
+// transposition tables and opening books are keyed by these values; changing
+// them means bumping those file versions.
+namespace zobrist {
+
+struct Keys {
+    uint64_t pieces[12][64]; // By piece index and square
+    uint64_t turn;           // Included when White is to move
+};
+
+constexpr uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+constexpr Keys build_keys() {
+    Keys keys{};
+    uint64_t state = 0;
+    for (auto& piece : keys.pieces) {
+        for (auto& key : piece) key = splitmix64(state);
+    }
+    keys.turn = splitmix64(state);
+    return keys;
+}
+
+inline constexpr Keys KEYS = build_keys();
+
+// Full hash of a position; make_move keeps CyrusEngine's up to date incrementally
+constexpr uint64_t hash(const Bitboards& bb, bool white_to_move) {
+    uint64_t h = white_to_move ? KEYS.turn : 0;
+    for (int piece = 0; piece < 12; ++piece) {
+        uint64_t b = bb.pieces[piece];
+        while (b) h ^= KEYS.pieces[piece][pop_lsb(b)];
+    }
+    return h;
+}
+
+} // namespace zobrist
+
+#endif // ZOBRIST_H
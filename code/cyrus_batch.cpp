@@ -0,0 +1,205 @@
+// cyrus-batch: parallel analysis of EPD positions.
+//
+// Reads one position per line from a file or stdin, searches each on a pool
+// of worker threads (one engine per thread), and writes one EPD line per
+// position in input order as soon as it and everything before it is done.
+//
+//   g++ -O2 -std=c++17 -pthread Cyrus.cpp Position.cpp TranspositionTable.cpp MovePicker.cpp SearchStats.cpp MappedFile.cpp OpeningBook.cpp Tablebase.cpp Nnue.cpp cyrus_batch.cpp -o cyrus-batch
+//
+// Usage: cyrus-batch [--depth N] [--movetime MS] [--nodes N] [--threads N] [--hash MB] [--tablebases DIR] [--nnue FILE] [FILE]
+//
+// Input lines are EPD: four position fields (as in Shatranj FEN, without the
+// move counters) followed by optional operations. The operations "depth",
+// "movetime" and "nodes" override the command-line limits for that position;
+// every other operation, such as id, is copied to the output. The output adds
+//   bm <move>; ce <centipawns, side to move>; acd <depth>; acn <nodes>; acs <seconds>;
+// with the move in the coordinate notation the engine uses elsewhere.
+// Blank lines and lines starting with '#' are skipped.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdlib>
+#include "Cyrus.h"
+
+struct Job {
+    size_t index;
+    std::string line;
+};
+
+// Hands lines to workers and writes results back out in input order. At most
+// `capacity` lines are in flight (queued, being searched or waiting for an
+// earlier line), so push() blocks the reader until output catches up.
+class BatchQueue {
+public:
+    explicit BatchQueue(size_t capacity) : capacity(std::max<size_t>(capacity, 1)) {}
+
+    void push(Job job) {
+        std::unique_lock<std::mutex> lock(mutex);
+        space.wait(lock, [this, &job] { return job.index < next_output + capacity; });
+        jobs.push_back(std::move(job));
+        job_ready.notify_one();
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        job_ready.notify_all();
+    }
+
+    bool pop(Job& job) {
+        std::unique_lock<std::mutex> lock(mutex);
+        job_ready.wait(lock, [this] { return closed || !jobs.empty(); });
+        if (jobs.empty()) return false;
+        job = std::move(jobs.front());
+        jobs.pop_front();
+        return true;
+    }
+
+    void finish(size_t index, std::string result) {
+        std::lock_guard<std::mutex> lock(mutex);
+        done[index] = std::move(result);
+        for (auto it = done.find(next_output); it != done.end(); it = done.find(next_output)) {
+            std::cout << it->second << '\n';
+            done.erase(it);
+            ++next_output;
+        }
+        std::cout.flush();
+        space.notify_one();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable job_ready;
+    std::condition_variable space; // Signalled as lines are written out
+    const size_t capacity;
+    std::deque<Job> jobs;
+    bool closed = false;
+    std::map<size_t, std::string> done; // Finished out of order, waiting for earlier lines
+    size_t next_output = 0;
+};
+
+static std::string trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+}
+
+static std::string analyze(CyrusEngine& engine, const std::string& line, const SearchLimits& defaults) {
+    std::istringstream in(line);
+    std::string fields[4];
+    for (auto& field : fields) in >> field;
+    std::string position = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3];
+    if (!engine.set_fen(position)) return position + " ; error \"invalid position\";";
+
+    // Operations are "opcode operands;" separated by semicolons
+    SearchLimits limits = defaults;
+    std::string rest, kept;
+    std::getline(in, rest);
+    std::istringstream ops(rest);
+    std::string op;
+    while (std::getline(ops, op, ';')) {
+        op = trim(op);
+        if (op.empty()) continue;
+        std::string opcode = op.substr(0, op.find(' '));
+        std::string operand = trim(op.substr(opcode.size()));
+        if (opcode == "depth") limits.depth = std::atoi(operand.c_str());
+        else if (opcode == "movetime") limits.soft_time_ms = limits.hard_time_ms = std::atoll(operand.c_str());
+        else if (opcode == "nodes") limits.nodes = std::strtoull(operand.c_str(), nullptr, 10);
+        else kept += " " + op + ";";
+    }
+
+    engine.new_game(); // Each result depends only on its own line
+    Move best = engine.find_best_move(engine.current_turn(), limits);
+    const SearchStats& stats = engine.get_search_stats();
+    int score = engine.current_turn() == 'w' ? stats.score : -stats.score;
+    if (best.from == -1) score = engine.is_in_check(engine.current_turn()) ? -CyrusEngine::MATE_SCORE : 0;
+
+    std::ostringstream out;
+    out << position << kept << " bm " << (best.from == -1 ? "none" : format_move(best)) << "; ce " << score
+        << "; acd " << stats.depth << "; acn " << stats.total_nodes() << "; acs " << stats.time_ms / 1000.0 << ";";
+    return out.str();
+}
+
+int main(int argc, char** argv) {
+    SearchLimits limits;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t hash_mb = 16;
+    std::string path;
+    std::shared_ptr<Tablebases> tablebases;
+    std::shared_ptr<NnueNetwork> network;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--depth" && i + 1 < argc) limits.depth = std::atoi(argv[++i]);
+        else if (arg == "--movetime" && i + 1 < argc) limits.soft_time_ms = limits.hard_time_ms = std::atoll(argv[++i]);
+        else if (arg == "--nodes" && i + 1 < argc) limits.nodes = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--threads" && i + 1 < argc) threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--hash" && i + 1 < argc) hash_mb = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--tablebases" && i + 1 < argc) {
+            tablebases = std::make_shared<Tablebases>();
+            if (!tablebases->open(argv[++i])) {
+                std::cerr << "No tablebases in " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--nnue" && i + 1 < argc) {
+            network = std::make_shared<NnueNetwork>();
+            if (!network->open(argv[++i])) {
+                std::cerr << "Cannot open network " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (path.empty() && arg[0] != '-') path = arg;
+        else {
+            std::cerr << "Usage: cyrus-batch [--depth N] [--movetime MS] [--nodes N] [--threads N] [--hash MB] [--tablebases DIR] [--nnue FILE] [FILE]" << std::endl;
+            return 2;
+        }
+    }
+
+    std::ifstream file;
+    if (!path.empty()) {
+        file.open(path);
+        if (!file) {
+            std::cerr << "Cannot open " << path << std::endl;
+            return 1;
+        }
+    }
+    std::istream& input = path.empty() ? std::cin : file;
+
+    BatchQueue queue(4 * static_cast<size_t>(threads));
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&queue, &limits, hash_mb, &tablebases, &network]() {
+            CyrusEngine engine;
+            engine.set_hash_size(hash_mb);
+            engine.tablebases = tablebases; // One mapping for every worker
+            engine.network = network;
+            Job job;
+            while (queue.pop(job)) {
+                queue.finish(job.index, analyze(engine, job.line, limits));
+            }
+        });
+    }
+
+    // Lines are queued as they arrive, so results start flowing before the input
+    // ends, and reading waits while the queue is full
+    std::string line;
+    size_t index = 0;
+    while (std::getline(input, line)) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#') continue;
+        queue.push({index++, line});
+    }
+    queue.close();
+    for (auto& w : workers) w.join();
+    return 0;
+}
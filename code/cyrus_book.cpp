@@ -0,0 +1,320 @@
+// cyrus-book: builds and inspects opening books.
+//
+//   g++ -O2 -std=c++17 -pthread Cyrus.cpp Position.cpp TranspositionTable.cpp MovePicker.cpp SearchStats.cpp MappedFile.cpp OpeningBook.cpp Tablebase.cpp Nnue.cpp cyrus_book.cpp -o cyrus-book
+//
+// Usage:
+//   cyrus-book build -o BOOK [--max-ply N] [--min-count N] FILE...
+//   cyrus-book selfplay -o BOOK [--games N] [--plies N] [--depth N] [--random-plies N] [--threads N]
+//   cyrus-book probe BOOK [FEN]
+//
+// build reads PGN files (*.pgn) and move-list files (anything else, one game
+// per line). Moves may be SAN, with N = Faras, B or A = Fil, R = Rukh, Q or
+// F = Ferz, K = Shah, or coordinate notation such as e2e4; move numbers,
+// comments, variations and NAGs are skipped. A move's weight is 2 per game the
+// mover's side won and 1 per draw or game without a result; moves played fewer
+// than --min-count times are dropped.
+//
+// selfplay plays the engine against itself from the start position and books
+// the engine's choice in every position reached, one point per game. The first
+// few moves of each game are random, so the games branch into varied lines.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <cstdlib>
+#include "Cyrus.h"
+
+struct MoveStats {
+    uint32_t count = 0;
+    uint64_t points = 0;
+};
+
+// Moves seen in each position: (key, packed move) -> stats
+using BookCounts = std::map<std::pair<uint64_t, uint16_t>, MoveStats>;
+
+static int san_piece_type(char c) {
+    switch (c) {
+        case 'N': return FARAS;
+        case 'B': case 'A': return FIL;
+        case 'R': return RUKH;
+        case 'Q': case 'F': return FERZ;
+        case 'K': return SHAH;
+        default: return -1;
+    }
+}
+
+// Resolves one SAN or coordinate move against the legal moves of the position
+static bool parse_move_token(CyrusEngine& engine, std::string token, Move& move) {
+    while (!token.empty() && std::strchr("+#!?", token.back())) token.pop_back();
+    size_t promotion = token.find('=');
+    if (promotion != std::string::npos) token.erase(promotion); // Pawns always promote to a Ferz
+    if (token.size() < 2) return false;
+
+    auto legal = engine.get_all_legal_moves(engine.current_turn());
+    if (token.size() == 4 && std::islower(token[0]) && std::isdigit(token[1]) && std::islower(token[2]) && std::isdigit(token[3])) {
+        for (const auto& m : legal) {
+            if (format_move(m) == token) {
+                move = m;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int type = PAWN;
+    size_t start = 0;
+    if (std::isupper(token[0])) {
+        type = san_piece_type(token[0]);
+        if (type < 0) return false;
+        start = 1;
+    }
+    std::string target = token.substr(token.size() - 2);
+    if (target[0] < 'a' || target[0] > 'h' || target[1] < '1' || target[1] > '8') return false;
+    int to = (8 - (target[1] - '0')) * 8 + (target[0] - 'a');
+    std::string hint; // Disambiguating file and/or rank
+    for (size_t i = start; i + 2 < token.size(); ++i) {
+        if (token[i] != 'x') hint += token[i];
+    }
+
+    int found = 0;
+    for (const auto& m : legal) {
+        if (m.to != to || piece_type(engine.get_bitboards().piece_on(m.from)) != type) continue;
+        bool matches = true;
+        for (char h : hint) {
+            if (h >= 'a' && h <= 'h') matches = matches && m.from % 8 == h - 'a';
+            else if (h >= '1' && h <= '8') matches = matches && m.from / 8 == 8 - (h - '0');
+            else matches = false;
+        }
+        if (matches) {
+            move = m;
+            ++found;
+        }
+    }
+    return found == 1;
+}
+
+static bool is_result(const std::string& token) {
+    return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+// Adds one game's moves, up to max_ply, to the counts
+static void add_game(const std::vector<std::string>& tokens, const std::string& result, int max_ply, BookCounts& counts) {
+    CyrusEngine engine;
+    engine.set_fen(START_FEN);
+    int ply = 0;
+    for (const auto& token : tokens) {
+        if (ply >= max_ply) break;
+        Move move;
+        if (!parse_move_token(engine, token, move)) {
+            std::cerr << "Skipping the rest of a game at unreadable move " << token << std::endl;
+            break;
+        }
+        bool white = engine.current_turn() == 'w';
+        int points = 1;
+        if (result == "1-0") points = white ? 2 : 0;
+        else if (result == "0-1") points = white ? 0 : 2;
+        MoveStats& s = counts[{engine.hash(), pack_move(move)}];
+        ++s.count;
+        s.points += points;
+        engine.make_move(move);
+        ++ply;
+    }
+}
+
+// Splits PGN text into games; tags, comments, variations, NAGs and move numbers are dropped
+static void read_pgn(std::istream& in, int max_ply, BookCounts& counts) {
+    std::vector<std::string> tokens;
+    std::string line, token;
+    int comment_depth = 0, variation_depth = 0;
+    while (std::getline(in, line)) {
+        if (comment_depth == 0 && variation_depth == 0 && !line.empty() && line[0] == '[') continue;
+        for (size_t i = 0; i <= line.size(); ++i) {
+            char c = i < line.size() ? line[i] : ' ';
+            if (comment_depth) {
+                if (c == '}') --comment_depth;
+                continue;
+            }
+            if (c == '{') { ++comment_depth; continue; }
+            if (c == ';' && !variation_depth) break; // Rest-of-line comment
+            if (c == '(') { ++variation_depth; continue; }
+            if (c == ')') { if (variation_depth) --variation_depth; continue; }
+            if (variation_depth) continue;
+            if (!std::isspace(static_cast<unsigned char>(c))) {
+                token += c;
+                continue;
+            }
+            if (token.empty()) continue;
+            size_t dot = token.find_last_of('.');
+            if (dot != std::string::npos) token.erase(0, dot + 1); // "12." or "12...e5"
+            if (is_result(token)) {
+                add_game(tokens, token, max_ply, counts);
+                tokens.clear();
+            } else if (!token.empty() && token[0] != '$') {
+                tokens.push_back(token);
+            }
+            token.clear();
+        }
+    }
+    if (!tokens.empty()) add_game(tokens, "*", max_ply, counts);
+}
+
+// One game per line
+static void read_move_list(std::istream& in, int max_ply, BookCounts& counts) {
+    std::string line, token;
+    while (std::getline(in, line)) {
+        std::istringstream words(line);
+        std::vector<std::string> tokens;
+        std::string result = "*";
+        while (words >> token) {
+            size_t dot = token.find_last_of('.');
+            if (dot != std::string::npos) token.erase(0, dot + 1);
+            if (is_result(token)) result = token;
+            else if (!token.empty()) tokens.push_back(token);
+        }
+        if (!tokens.empty()) add_game(tokens, result, max_ply, counts);
+    }
+}
+
+static bool write_book(const std::string& path, const BookCounts& counts, uint32_t min_count) {
+    uint64_t max_points = 1;
+    for (const auto& c : counts) max_points = std::max(max_points, c.second.points);
+    std::vector<BookEntry> entries;
+    for (const auto& c : counts) {
+        if (c.second.count < min_count || c.second.points == 0) continue;
+        // Scale into 16 bits, keeping every surviving move at weight 1 or more
+        uint64_t weight = max_points > 65535 ? std::max<uint64_t>(c.second.points * 65535 / max_points, 1) : c.second.points;
+        entries.push_back({c.first.first, c.first.second, static_cast<uint16_t>(weight), 0});
+    }
+    if (!OpeningBook::write(path, entries)) {
+        std::cerr << "Cannot write " << path << std::endl;
+        return false;
+    }
+    std::cout << "Wrote " << entries.size() << " entries for " << counts.size() << " position/move pairs to " << path << std::endl;
+    return true;
+}
+
+static void self_play(int games, int plies, int depth, int random_plies, int threads, BookCounts& counts) {
+    std::atomic<int> next_game(0);
+    std::mutex merge_mutex;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&]() {
+            CyrusEngine engine;
+            BookCounts local;
+            SearchLimits limits;
+            limits.depth = depth;
+            for (int game = next_game++; game < games; game = next_game++) {
+                std::mt19937 rng(game); // Reproducible openings, whatever the thread count
+                engine.new_game();
+                engine.set_fen(START_FEN);
+                for (int ply = 0; ply < plies && !engine.is_game_over(engine.current_turn()); ++ply) {
+                    // Every position visited books the engine's choice; the game
+                    // itself may continue with a random move instead
+                    Move move = engine.find_best_move(engine.current_turn(), limits);
+                    MoveStats& s = local[{engine.hash(), pack_move(move)}];
+                    ++s.count;
+                    ++s.points;
+                    if (ply < random_plies) {
+                        auto legal = engine.get_all_legal_moves(engine.current_turn());
+                        move = legal[std::uniform_int_distribution<size_t>(0, legal.size() - 1)(rng)];
+                    }
+                    engine.make_move(move);
+                }
+            }
+            std::lock_guard<std::mutex> lock(merge_mutex);
+            for (const auto& c : local) {
+                MoveStats& s = counts[c.first];
+                s.count += c.second.count;
+                s.points += c.second.points;
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+}
+
+static int probe(const std::string& path, const std::string& fen) {
+    OpeningBook book;
+    if (!book.open(path)) {
+        std::cerr << "Cannot open book " << path << std::endl;
+        return 1;
+    }
+    CyrusEngine engine;
+    if (!engine.set_fen(fen)) {
+        std::cerr << "Invalid FEN: " << fen << std::endl;
+        return 2;
+    }
+    std::cout << book.size() << " entries; " << fen << std::endl;
+    for (const auto& e : book.lookup(engine.hash())) {
+        std::cout << format_move(unpack_move(e.move)) << " " << e.weight << std::endl;
+    }
+    return 0;
+}
+
+static int usage() {
+    std::cerr << "Usage:\n"
+              << "  cyrus-book build -o BOOK [--max-ply N] [--min-count N] FILE...\n"
+              << "  cyrus-book selfplay -o BOOK [--games N] [--plies N] [--depth N] [--random-plies N] [--threads N]\n"
+              << "  cyrus-book probe BOOK [FEN]" << std::endl;
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) return usage();
+    std::string mode = argv[1];
+    if (mode == "probe") {
+        if (argc < 3) return usage();
+        std::string fen = START_FEN;
+        if (argc > 3) {
+            fen.clear();
+            for (int i = 3; i < argc; ++i) fen += (i > 3 ? " " : "") + std::string(argv[i]);
+        }
+        return probe(argv[2], fen);
+    }
+    if (mode != "build" && mode != "selfplay") return usage();
+
+    std::string output;
+    int max_ply = 16, games = 100, plies = 16, depth = 8, random_plies = 2;
+    uint32_t min_count = 1;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> inputs;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) output = argv[++i];
+        else if (arg == "--max-ply" && i + 1 < argc) max_ply = std::atoi(argv[++i]);
+        else if (arg == "--min-count" && i + 1 < argc) min_count = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--games" && i + 1 < argc) games = std::atoi(argv[++i]);
+        else if (arg == "--plies" && i + 1 < argc) plies = std::atoi(argv[++i]);
+        else if (arg == "--depth" && i + 1 < argc) depth = std::atoi(argv[++i]);
+        else if (arg == "--random-plies" && i + 1 < argc) random_plies = std::atoi(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc) threads = std::max(1, std::atoi(argv[++i]));
+        else if (mode == "build" && arg[0] != '-') inputs.push_back(arg);
+        else return usage();
+    }
+    if (output.empty() || (mode == "build" && inputs.empty())) return usage();
+
+    BookCounts counts;
+    if (mode == "build") {
+        for (const auto& path : inputs) {
+            std::ifstream in(path);
+            if (!in) {
+                std::cerr << "Cannot open " << path << std::endl;
+                return 1;
+            }
+            bool pgn = path.size() > 4 && path.compare(path.size() - 4, 4, ".pgn") == 0;
+            if (pgn) read_pgn(in, max_ply, counts);
+            else read_move_list(in, max_ply, counts);
+        }
+    } else {
+        self_play(games, plies, depth, random_plies, threads, counts);
+    }
+    return write_book(output, counts, min_count) ? 0 : 1;
+}
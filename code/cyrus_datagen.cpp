@@ -0,0 +1,193 @@
+// cyrus-datagen: generates scored positions for tuning by self-play.
+//
+// Each thread plays games against itself from a few random opening moves,
+// with a short search per move, and keeps the quiet positions it passes
+// through with their search score. Once a game is over its result is filled
+// in and its positions are appended to one training file (see TrainingData.h).
+//
+//   g++ -O2 -std=c++17 -pthread Cyrus.cpp Position.cpp TranspositionTable.cpp MovePicker.cpp SearchStats.cpp MappedFile.cpp OpeningBook.cpp Tablebase.cpp Nnue.cpp TrainingData.cpp cyrus_datagen.cpp -o cyrus-datagen
+//
+// Usage: cyrus-datagen [--games N] [--threads N] [--nodes N | --depth N] [--random-plies N]
+//                      [--max-plies N] [--hash MB] [--seed N] [--tablebases DIR] FILE
+//
+// A position is kept unless the side to move is in check, the move played is
+// a capture, or the score is already decisive; those say little about the
+// static evaluation. Games end by the search's rules (checkmate loses,
+// stalemate, bare kings, threefold repetition and --max-plies draw) or are
+// adjudicated once both sides' scores have agreed on a winner for several
+// moves. The search does not see repetitions, so a side well ahead can
+// repeat by accident; such a repetition is scored as a win for that side
+// rather than a draw. Game n of a run with seed s always starts from the same
+// opening.
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include "Cyrus.h"
+#include "TrainingData.h"
+
+static const int MAX_RECORDED_SCORE = 3000; // Positions scored beyond this are decided and not kept
+static const int ADJUDICATE_SCORE = 1500;   // A game is won once the score stays past this...
+static const int ADJUDICATE_PLIES = 8;      // ...for this many plies in a row
+static const int REPETITION_WIN_SCORE = 400; // A repetition with the score past this is a win, not a draw
+
+struct GameRecord {
+    std::vector<TrainingRecord> positions;
+    int result = 0; // White's view
+};
+
+// A few random moves from the start position, never into a finished game
+static void random_opening(CyrusEngine& engine, std::mt19937_64& rng, int plies) {
+    for (;;) {
+        engine.set_fen(START_FEN);
+        int ply = 0;
+        for (; ply < plies; ++ply) {
+            auto legal = engine.get_all_legal_moves(engine.current_turn());
+            if (legal.empty()) break;
+            engine.make_move(legal[std::uniform_int_distribution<size_t>(0, legal.size() - 1)(rng)]);
+        }
+        if (ply == plies && !engine.is_game_over(engine.current_turn())) return;
+    }
+}
+
+static void play_game(CyrusEngine& engine, std::mt19937_64& rng, int random_plies, int max_plies,
+                      const SearchLimits& limits, GameRecord& game) {
+    engine.new_game();
+    random_opening(engine, rng, random_plies);
+    game.positions.clear();
+    game.result = 0;
+
+    std::vector<uint64_t> seen = {engine.hash()};
+    int streak = 0, streak_winner = 0; // Plies in a row the score has been past ADJUDICATE_SCORE for one side
+    for (int ply = random_plies; ply < max_plies; ++ply) {
+        char turn = engine.current_turn();
+        Move move = engine.find_best_move(turn, limits);
+        if (move.from == -1) {
+            // Checkmate loses, stalemate is a draw
+            if (engine.is_in_check(turn)) game.result = turn == 'w' ? -1 : 1;
+            return;
+        }
+        int score = engine.get_search_stats().score;
+        const Bitboards& bb = engine.get_bitboards();
+        bool quiet = bb.piece_on(move.to) == NO_PIECE && !engine.is_in_check(turn);
+        if (quiet && std::abs(score) < MAX_RECORDED_SCORE) {
+            game.positions.push_back(TrainingRecord::from(bb, turn == 'w' ? WHITE : BLACK, score, ply));
+        }
+
+        int winner = std::abs(score) >= ADJUDICATE_SCORE ? (score > 0 ? 1 : -1) : 0;
+        streak = winner == 0 ? 0 : winner == streak_winner ? streak + 1 : 1;
+        streak_winner = winner;
+        if (streak >= ADJUDICATE_PLIES) {
+            game.result = winner;
+            return;
+        }
+
+        engine.make_move(move);
+        if (popcount(engine.get_bitboards().occupied) == 2) return; // Bare kings
+        uint64_t key = engine.hash();
+        if (std::count(seen.begin(), seen.end(), key) >= 2) { // Third occurrence
+            if (std::abs(score) >= REPETITION_WIN_SCORE) game.result = score > 0 ? 1 : -1;
+            return;
+        }
+        seen.push_back(key);
+    }
+}
+
+static int usage() {
+    std::cerr << "Usage: cyrus-datagen [--games N] [--threads N] [--nodes N | --depth N] [--random-plies N]\n"
+                 "                     [--max-plies N] [--hash MB] [--seed N] [--tablebases DIR] FILE" << std::endl;
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    uint64_t games = 1000;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    SearchLimits limits;
+    int random_plies = 8;
+    int max_plies = 400;
+    size_t hash_mb = 16;
+    uint64_t seed = 1;
+    std::string path;
+    std::shared_ptr<Tablebases> tablebases;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--games" && has_value) games = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--threads" && has_value) threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--nodes" && has_value) limits.nodes = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--depth" && has_value) limits.depth = std::atoi(argv[++i]);
+        else if (arg == "--random-plies" && has_value) random_plies = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--max-plies" && has_value) max_plies = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--hash" && has_value) hash_mb = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--seed" && has_value) seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--tablebases" && has_value) {
+            tablebases = std::make_shared<Tablebases>();
+            if (!tablebases->open(argv[++i])) {
+                std::cerr << "No tablebases in " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (path.empty() && arg[0] != '-') path = arg;
+        else return usage();
+    }
+    if (path.empty()) return usage();
+    if (!limits.nodes && !limits.depth) limits.nodes = 5000;
+
+    TrainingWriter writer;
+    if (!writer.open(path)) {
+        std::cerr << "Cannot create " << path << std::endl;
+        return 1;
+    }
+
+    std::atomic<uint64_t> next_game(0);
+    std::mutex writer_mutex;
+    uint64_t finished = 0;
+    int results[3] = {0, 0, 0}; // Black wins, draws, White wins
+    bool write_failed = false;
+    auto started = std::chrono::steady_clock::now();
+    auto report = [&]() {
+        double seconds = std::max(std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count(), 1e-9);
+        std::cerr << "Games " << finished << " (+" << results[2] << " =" << results[1] << " -" << results[0] << ")  positions "
+                  << writer.records() << "  " << static_cast<uint64_t>(writer.records() / seconds * 3600) << "/hour" << std::endl;
+    };
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&]() {
+            CyrusEngine engine;
+            engine.set_hash_size(hash_mb);
+            engine.tablebases = tablebases;
+            GameRecord game;
+            for (uint64_t n = next_game++; n < games; n = next_game++) {
+                std::mt19937_64 rng(seed * 0x9E3779B97F4A7C15ULL + n);
+                play_game(engine, rng, random_plies, max_plies, limits, game);
+
+                std::lock_guard<std::mutex> lock(writer_mutex);
+                for (TrainingRecord& record : game.positions) {
+                    record.result = static_cast<int8_t>(game.result);
+                    write_failed |= !writer.write(record);
+                }
+                ++results[game.result + 1];
+                if (++finished % 100 == 0) report();
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+
+    write_failed |= !writer.close();
+    if (finished % 100 != 0) report();
+    std::cerr << "Wrote " << writer.bytes() << " bytes, " << (writer.records() ? static_cast<double>(writer.bytes()) / writer.records() : 0.0)
+              << " per position" << std::endl;
+    if (write_failed) {
+        std::cerr << "Error writing " << path << std::endl;
+        return 1;
+    }
+    return 0;
+}
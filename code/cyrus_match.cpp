@@ -0,0 +1,348 @@
+// cyrus-match: plays two engine configurations against each other.
+//
+// Games run in parallel, one pair of engines per thread. Every opening is
+// played twice with the colors swapped, and every move is searched under the
+// same fixed limit. The report gives the result from A's side as Elo with a
+// 95% error bar, a sequential probability ratio test (SPRT) for
+// elo0 against elo1, and each side's speed and time use.
+//
+//   g++ -O2 -std=c++17 -pthread Cyrus.cpp Position.cpp TranspositionTable.cpp MovePicker.cpp SearchStats.cpp MappedFile.cpp OpeningBook.cpp Tablebase.cpp Nnue.cpp cyrus_match.cpp -o cyrus-match
+//
+// Usage: cyrus-match [--a CONFIG] [--b CONFIG] [--games N] [--threads N]
+//                    [--movetime MS | --nodes N | --depth N] [--openings FILE] [--random-plies N]
+//                    [--max-plies N] [--elo0 E] [--elo1 E] [--alpha A] [--beta B] [--sprt] [--report N]
+//
+// A CONFIG is a comma-separated list of settings applied to the defaults:
+//   name=<label>  hash=<MB>  threads=<N>  legal_movegen=0|1  nnue=<network file>
+//   pvs aspiration null_move lmr killers history countermoves see delta_pruning, each =0|1
+// e.g. --a name=base --b "name=no-lmr,lmr=0".
+//
+// Openings are FEN/EPD lines (the first four fields are used), taken in order
+// and reused from the top if there are fewer than the games need; without a
+// file each pair starts from --random-plies random moves from the start
+// position, seeded by the pair number. Games end as the search scores them:
+// checkmate loses, stalemate and bare kings are draws; so are a threefold
+// repetition and reaching --max-plies. With --sprt the match stops as soon as
+// the test accepts either hypothesis.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "Cyrus.h"
+
+struct EngineConfig {
+    std::string name;
+    SearchFeatures features;
+    bool legal_movegen = true;
+    size_t hash_mb = 16;
+    int threads = 1;
+    std::shared_ptr<const NnueNetwork> network; // Material + PST evaluation if none
+};
+
+static bool parse_config(const std::string& spec, EngineConfig& config) {
+    std::istringstream in(spec);
+    std::string setting;
+    while (std::getline(in, setting, ',')) {
+        if (setting.empty()) continue;
+        size_t eq = setting.find('=');
+        if (eq == std::string::npos) return false;
+        std::string key = setting.substr(0, eq), value = setting.substr(eq + 1);
+        bool on = value != "0";
+        SearchFeatures& f = config.features;
+        if (key == "name") config.name = value;
+        else if (key == "hash") config.hash_mb = std::max(1, std::atoi(value.c_str()));
+        else if (key == "threads") config.threads = std::max(1, std::atoi(value.c_str()));
+        else if (key == "legal_movegen") config.legal_movegen = on;
+        else if (key == "nnue") {
+            auto network = std::make_shared<NnueNetwork>();
+            if (!network->open(value)) return false;
+            config.network = network;
+        }
+        else if (key == "pvs") f.pvs = on;
+        else if (key == "aspiration") f.aspiration = on;
+        else if (key == "null_move") f.null_move = on;
+        else if (key == "lmr") f.lmr = on;
+        else if (key == "killers") f.killers = on;
+        else if (key == "history") f.history = on;
+        else if (key == "countermoves") f.countermoves = on;
+        else if (key == "see") f.see = on;
+        else if (key == "delta_pruning") f.delta_pruning = on;
+        else return false;
+    }
+    return true;
+}
+
+static void configure(CyrusEngine& engine, const EngineConfig& config) {
+    engine.features = config.features;
+    engine.use_legal_movegen = config.legal_movegen;
+    engine.set_hash_size(config.hash_mb);
+    engine.search_threads = config.threads;
+    engine.network = config.network;
+}
+
+// Search effort of one configuration, summed over its moves
+struct Usage {
+    uint64_t moves = 0;
+    uint64_t nodes = 0;
+    uint64_t depth = 0;
+    double time_ms = 0;
+    double max_time_ms = 0;
+
+    void add(const Usage& other) {
+        moves += other.moves;
+        nodes += other.nodes;
+        depth += other.depth;
+        time_ms += other.time_ms;
+        max_time_ms = std::max(max_time_ms, other.max_time_ms);
+    }
+};
+
+// Wins, draws and losses from A's side
+struct Score {
+    int wins = 0, draws = 0, losses = 0;
+
+    int games() const { return wins + draws + losses; }
+    double mean() const { return games() ? (wins + 0.5 * draws) / games() : 0.5; }
+    // Per-game variance of the score
+    double variance() const {
+        if (!games()) return 0;
+        double m = mean(), n = games();
+        return (wins * (1 - m) * (1 - m) + draws * (0.5 - m) * (0.5 - m) + losses * m * m) / n;
+    }
+};
+
+static double elo_from_score(double score) {
+    score = std::min(std::max(score, 1e-6), 1 - 1e-6);
+    return -400.0 * std::log10(1.0 / score - 1.0);
+}
+
+static double score_from_elo(double elo) {
+    return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
+
+// Generalized SPRT log-likelihood ratio of elo1 over elo0, with the normal
+// approximation to the per-game score distribution
+static double sprt_llr(const Score& score, double elo0, double elo1) {
+    double variance = score.variance();
+    if (score.games() < 2 || variance <= 0) return 0;
+    double s0 = score_from_elo(elo0), s1 = score_from_elo(elo1);
+    return score.games() * (s1 - s0) * (2 * score.mean() - s0 - s1) / (2 * variance);
+}
+
+// Plays one game from `fen`; returns 1, 0 or -1 from the side of engines[0]
+static int play_game(CyrusEngine* engines[2], int white, const std::string& fen,
+                     const SearchLimits& limits, int max_plies, Usage usage[2]) {
+    for (int i = 0; i < 2; ++i) {
+        engines[i]->new_game();
+        engines[i]->set_fen(fen);
+    }
+    std::vector<uint64_t> seen = {engines[0]->hash()};
+    for (int ply = 0; ply < max_plies; ++ply) {
+        char turn = engines[0]->current_turn();
+        int mover = (turn == 'w') == (white == 0) ? 0 : 1;
+        CyrusEngine& engine = *engines[mover];
+
+        auto started = std::chrono::steady_clock::now();
+        Move move = engine.find_best_move(turn, limits);
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        if (move.from == -1) {
+            // Checkmate loses, stalemate is a draw
+            if (!engine.is_in_check(turn)) return 0;
+            return mover == 0 ? -1 : 1;
+        }
+        const SearchStats& stats = engine.get_search_stats();
+        Usage& u = usage[mover];
+        ++u.moves;
+        u.nodes += stats.total_nodes();
+        u.depth += stats.depth;
+        u.time_ms += elapsed;
+        u.max_time_ms = std::max(u.max_time_ms, elapsed);
+
+        for (int i = 0; i < 2; ++i) engines[i]->make_move(move);
+        if (popcount(engines[0]->get_bitboards().occupied) == 2) return 0; // Bare kings
+        uint64_t key = engines[0]->hash();
+        if (std::count(seen.begin(), seen.end(), key) >= 2) return 0; // Third occurrence
+        seen.push_back(key);
+    }
+    return 0;
+}
+
+static std::vector<std::string> load_openings(const std::string& path) {
+    std::vector<std::string> openings;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string field, fen;
+        for (int i = 0; i < 4 && fields >> field; ++i) fen += (fen.empty() ? "" : " ") + field;
+        CyrusEngine check;
+        if (!fen.empty() && fen[0] != '#' && check.set_fen(fen)) openings.push_back(fen);
+    }
+    return openings;
+}
+
+// A few random moves from the start position, never into a finished game
+static std::string random_opening(int pair, int plies) {
+    std::mt19937 rng(pair);
+    for (;;) {
+        CyrusEngine engine;
+        int ply = 0;
+        for (; ply < plies; ++ply) {
+            auto legal = engine.get_all_legal_moves(engine.current_turn());
+            if (legal.empty()) break;
+            engine.make_move(legal[std::uniform_int_distribution<size_t>(0, legal.size() - 1)(rng)]);
+        }
+        if (ply == plies && !engine.is_game_over(engine.current_turn())) return engine.get_fen();
+    }
+}
+
+static void print_usage(const std::string& name, const Usage& u) {
+    double seconds = u.time_ms / 1000.0;
+    std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(1)
+              << " nps " << std::setw(10) << static_cast<uint64_t>(seconds > 0 ? u.nodes / seconds : 0)
+              << "  avg " << std::setw(7) << (u.moves ? u.time_ms / u.moves : 0) << " ms/move"
+              << "  max " << std::setw(7) << u.max_time_ms << " ms"
+              << "  avg depth " << std::setw(5) << (u.moves ? static_cast<double>(u.depth) / u.moves : 0)
+              << "  moves " << u.moves << std::endl;
+}
+
+struct SprtSettings {
+    double elo0 = 0, elo1 = 10, alpha = 0.05, beta = 0.05;
+    double lower() const { return std::log(beta / (1 - alpha)); }
+    double upper() const { return std::log((1 - beta) / alpha); }
+};
+
+static void print_report(const EngineConfig& a, const EngineConfig& b, const Score& score,
+                         const SprtSettings& sprt, const Usage usage[2]) {
+    double mean = score.mean();
+    double margin = score.games() > 1 ? 1.96 * std::sqrt(score.variance() / score.games()) : 0.5;
+    double elo = elo_from_score(mean);
+    double low = elo_from_score(mean - margin), high = elo_from_score(mean + margin);
+    double llr = sprt_llr(score, sprt.elo0, sprt.elo1);
+    const char* verdict = llr >= sprt.upper() ? "H1 accepted" : llr <= sprt.lower() ? "H0 accepted" : "continue";
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "Games " << score.games() << ": " << a.name << " +" << score.wins << " =" << score.draws
+              << " -" << score.losses << " (" << 100 * mean << "%)" << std::endl
+              << "Elo " << a.name << " - " << b.name << ": " << std::showpos << elo << std::noshowpos
+              << " +/- " << (high - low) / 2 << " (95%)" << std::endl
+              << std::setprecision(2) << "SPRT elo0=" << sprt.elo0 << " elo1=" << sprt.elo1
+              << " alpha=" << sprt.alpha << " beta=" << sprt.beta << ": LLR " << llr
+              << " [" << sprt.lower() << ", " << sprt.upper() << "] " << verdict << std::endl;
+    print_usage(a.name, usage[0]);
+    print_usage(b.name, usage[1]);
+}
+
+int main(int argc, char** argv) {
+    EngineConfig configs[2];
+    configs[0].name = "A";
+    configs[1].name = "B";
+    int games = 100;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    SearchLimits limits;
+    std::string openings_path;
+    int random_plies = 8;
+    int max_plies = 400;
+    SprtSettings sprt;
+    bool stop_on_sprt = false;
+    int report_every = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if ((arg == "--a" || arg == "--b") && has_value) {
+            if (!parse_config(argv[++i], configs[arg == "--a" ? 0 : 1])) {
+                std::cerr << "Invalid configuration: " << argv[i] << std::endl;
+                return 2;
+            }
+        }
+        else if (arg == "--games" && has_value) games = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--threads" && has_value) threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--movetime" && has_value) limits.soft_time_ms = limits.hard_time_ms = std::atoll(argv[++i]);
+        else if (arg == "--nodes" && has_value) limits.nodes = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--depth" && has_value) limits.depth = std::atoi(argv[++i]);
+        else if (arg == "--openings" && has_value) openings_path = argv[++i];
+        else if (arg == "--random-plies" && has_value) random_plies = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--max-plies" && has_value) max_plies = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--elo0" && has_value) sprt.elo0 = std::atof(argv[++i]);
+        else if (arg == "--elo1" && has_value) sprt.elo1 = std::atof(argv[++i]);
+        else if (arg == "--alpha" && has_value) sprt.alpha = std::atof(argv[++i]);
+        else if (arg == "--beta" && has_value) sprt.beta = std::atof(argv[++i]);
+        else if (arg == "--sprt") stop_on_sprt = true;
+        else if (arg == "--report" && has_value) report_every = std::max(0, std::atoi(argv[++i]));
+        else {
+            std::cerr << "Usage: cyrus-match [--a CONFIG] [--b CONFIG] [--games N] [--threads N]\n"
+                         "                   [--movetime MS | --nodes N | --depth N] [--openings FILE] [--random-plies N]\n"
+                         "                   [--max-plies N] [--elo0 E] [--elo1 E] [--alpha A] [--beta B] [--sprt] [--report N]"
+                      << std::endl;
+            return 2;
+        }
+    }
+    if (!limits.soft_time_ms && !limits.nodes && !limits.depth) limits.soft_time_ms = limits.hard_time_ms = 50;
+
+    std::vector<std::string> openings;
+    if (!openings_path.empty()) {
+        openings = load_openings(openings_path);
+        if (openings.empty()) {
+            std::cerr << "No positions in " << openings_path << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "Match " << configs[0].name << " vs " << configs[1].name << ": " << games << " games on "
+              << threads << " threads, ";
+    if (limits.nodes) std::cout << limits.nodes << " nodes";
+    else if (limits.depth) std::cout << "depth " << limits.depth;
+    else std::cout << limits.hard_time_ms << " ms";
+    std::cout << " per move" << std::endl;
+
+    std::atomic<int> next_game(0);
+    std::atomic<bool> decided(false);
+    std::mutex results_mutex;
+    Score score;
+    Usage usage[2];
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&]() {
+            CyrusEngine a, b;
+            configure(a, configs[0]);
+            configure(b, configs[1]);
+            CyrusEngine* engines[2] = {&a, &b};
+            for (int game = next_game++; game < games && !decided; game = next_game++) {
+                int pair = game / 2;
+                std::string fen = openings.empty() ? random_opening(pair, random_plies)
+                                                   : openings[pair % openings.size()];
+                Usage game_usage[2];
+                int result = play_game(engines, game % 2, fen, limits, max_plies, game_usage);
+
+                std::lock_guard<std::mutex> lock(results_mutex);
+                if (decided) return; // Past the SPRT decision; not counted
+                (result > 0 ? score.wins : result < 0 ? score.losses : score.draws)++;
+                for (int i = 0; i < 2; ++i) usage[i].add(game_usage[i]);
+                double llr = sprt_llr(score, sprt.elo0, sprt.elo1);
+                if (report_every && score.games() % report_every == 0 && score.games() < games) {
+                    std::cout << std::fixed << std::setprecision(1) << "Games " << score.games() << ": +" << score.wins
+                              << " =" << score.draws << " -" << score.losses << "  Elo " << std::showpos
+                              << elo_from_score(score.mean()) << std::noshowpos << std::setprecision(2)
+                              << "  LLR " << llr << std::endl;
+                }
+                if (stop_on_sprt && (llr >= sprt.upper() || llr <= sprt.lower())) decided = true;
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+
+    print_report(configs[0], configs[1], score, sprt, usage);
+    return 0;
+}
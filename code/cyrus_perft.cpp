@@ -0,0 +1,166 @@
+// cyrus-perft: move generation correctness and speed suite.
+//
+// Runs perft on a set of Shatranj reference positions, checks every depth
+// against the expected node counts, then runs the same suite on several
+// threads at once to report aggregate nodes-per-second.
+//
+//   g++ -O2 -std=c++17 -pthread Cyrus.cpp Position.cpp TranspositionTable.cpp MovePicker.cpp SearchStats.cpp MappedFile.cpp OpeningBook.cpp Tablebase.cpp Nnue.cpp cyrus_perft.cpp -o cyrus-perft
+//
+// Usage: cyrus-perft [--depth N] [--threads N] [--pseudo] [--divide N] [--position NAME]
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include "Cyrus.h"
+
+struct PerftCase {
+    std::string name;
+    std::vector<std::string> rows; // Row 8 first, '.' for empty
+    char turn;
+    std::vector<uint64_t> expected; // Node counts for depth 1, 2, ...
+};
+
+// Counts were cross-checked against an independent make/unmake implementation
+// (the original char-board generator) through depth 5.
+static const std::vector<PerftCase> SUITE = {
+    {"start",
+     {"rnbkqbnr", "pppppppp", "........", "........", "........", "........", "PPPPPPPP", "RNBKQBNR"}, 'w',
+     {16, 256, 4176, 68122, 1164248, 19864709}},
+    {"middlegame",
+     {"r.bk.b.r", ".pp.qpp.", "p.np.n.p", "....p...", "...PP...", "P.N..N.P", ".PP.QPP.", "R.BK.B.R"}, 'w',
+     {27, 702, 18579, 459932, 12013099}},
+    {"open-files",
+     {"r..k...r", "pp.q.pp.", "..n.b..p", "..p.p...", "..P.P.n.", ".PN..B..", "PP.Q.PPP", "R..K...R"}, 'b',
+     {29, 626, 17985, 404243, 11493947}},
+    {"rook-pins",
+     {"...k....", "....r...", "........", ".R..p..r", "........", "....N...", "....Q...", "r...K..R"}, 'w',
+     {5, 171, 4887, 155985, 4605747}},
+    {"promotion",
+     {"....k...", ".P...bP.", "..r.....", "........", "........", "....n...", ".p...Bp.", "R...K..."}, 'w',
+     {16, 428, 6717, 169428, 2759546}},
+    {"check-evasion",
+     {"...k.r..", "pp......", "........", "........", "........", "..n.....", "PP.P....", "...KR..r"}, 'w',
+     {4, 116, 1603, 48509, 765310, 23148393}},
+    {"ferz-endgame",
+     {"........", ".k......", ".q.p....", "..Q.P...", "...P....", "..K.....", "........", "........"}, 'b',
+     {14, 170, 1785, 20666, 188083, 2067463}},
+};
+
+static void load_case(CyrusEngine& engine, const PerftCase& pc) {
+    std::vector<std::vector<char>> layout;
+    for (const auto& row : pc.rows) {
+        layout.emplace_back(row.begin(), row.end());
+    }
+    engine.set_board(layout, pc.turn);
+}
+
+static int case_depth(const PerftCase& pc, int max_depth) {
+    int depth = static_cast<int>(pc.expected.size());
+    return max_depth > 0 ? std::min(depth, max_depth) : depth;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Runs every position once on this thread; returns the total node count.
+static uint64_t run_suite(int max_depth, bool pseudo, bool verbose, bool& all_passed) {
+    CyrusEngine engine;
+    engine.use_legal_movegen = !pseudo;
+    uint64_t total = 0;
+    for (const auto& pc : SUITE) {
+        load_case(engine, pc);
+        int depth = case_depth(pc, max_depth);
+        for (int d = 1; d <= depth; ++d) {
+            auto start = std::chrono::steady_clock::now();
+            uint64_t nodes = engine.perft(d);
+            double elapsed = seconds_since(start);
+            total += nodes;
+            bool ok = nodes == pc.expected[d - 1];
+            all_passed = all_passed && ok;
+            if (verbose && (d == depth || !ok)) {
+                std::cout << std::left << std::setw(16) << pc.name << " depth " << d
+                          << std::right << std::setw(12) << nodes
+                          << (ok ? "  ok  " : "  FAIL (expected " + std::to_string(pc.expected[d - 1]) + ")  ")
+                          << std::fixed << std::setprecision(3) << elapsed << "s  "
+                          << static_cast<uint64_t>(nodes / std::max(elapsed, 1e-9)) << " nps" << std::endl;
+            }
+        }
+    }
+    return total;
+}
+
+int main(int argc, char** argv) {
+    int max_depth = 0;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    bool pseudo = false;
+    int divide_depth = 0;
+    std::string position = "start";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--depth" && i + 1 < argc) max_depth = std::atoi(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc) threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--pseudo") pseudo = true;
+        else if (arg == "--divide" && i + 1 < argc) divide_depth = std::atoi(argv[++i]);
+        else if (arg == "--position" && i + 1 < argc) position = argv[++i];
+        else {
+            std::cerr << "Usage: cyrus-perft [--depth N] [--threads N] [--pseudo] [--divide N] [--position NAME]" << std::endl;
+            return 2;
+        }
+    }
+
+    if (divide_depth > 0) {
+        for (const auto& pc : SUITE) {
+            if (pc.name != position) continue;
+            CyrusEngine engine;
+            engine.use_legal_movegen = !pseudo;
+            load_case(engine, pc);
+            uint64_t total = 0;
+            for (const auto& entry : engine.divide(divide_depth)) {
+                std::cout << format_move(entry.first) << ": " << entry.second << std::endl;
+                total += entry.second;
+            }
+            std::cout << "Total: " << total << std::endl;
+            return 0;
+        }
+        std::cerr << "Unknown position: " << position << std::endl;
+        return 2;
+    }
+
+    std::cout << "--- Cyrus perft suite (" << (pseudo ? "pseudo-legal filter" : "legal generator") << ") ---" << std::endl;
+    bool all_passed = true;
+    auto start = std::chrono::steady_clock::now();
+    uint64_t nodes = run_suite(max_depth, pseudo, true, all_passed);
+    double elapsed = seconds_since(start);
+    uint64_t single_nps = static_cast<uint64_t>(nodes / std::max(elapsed, 1e-9));
+    std::cout << "1 thread:  " << nodes << " nodes in " << std::fixed << std::setprecision(3) << elapsed
+              << "s, " << single_nps << " nps" << std::endl;
+
+    if (threads > 1) {
+        std::atomic<uint64_t> total_nodes(0);
+        std::atomic<bool> threads_passed(true);
+        std::vector<std::thread> workers;
+        start = std::chrono::steady_clock::now();
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&]() {
+                bool passed = true;
+                total_nodes += run_suite(max_depth, pseudo, false, passed);
+                if (!passed) threads_passed = false;
+            });
+        }
+        for (auto& w : workers) w.join();
+        elapsed = seconds_since(start);
+        all_passed = all_passed && threads_passed;
+        std::cout << threads << " threads: " << total_nodes << " nodes in " << elapsed << "s, "
+                  << static_cast<uint64_t>(total_nodes / std::max(elapsed, 1e-9)) << " nps" << std::endl;
+    }
+
+    std::cout << (all_passed ? "All node counts match." : "NODE COUNT MISMATCH") << std::endl;
+    return all_passed ? 0 : 1;
+}
@@ -0,0 +1,357 @@
+// cyrus: Python bindings for CyrusEngine.
+//
+// A CPython extension module with one class, cyrus.Engine, so Python code can
+// search with the C++ engine instead of the pure-Python one in
+// PAP-Python-Cyrus.py. Built by setup.py in this directory:
+//
+//   python3 setup.py build_ext --inplace
+//
+//   >>> import cyrus
+//   >>> engine = cyrus.Engine()                # Or Engine(fen, hash_mb=16, threads=1)
+//   >>> engine.legal_moves()[:3]
+//   ['a2a3', 'b2b3', 'c2c3']
+//   >>> engine.make_move("b1c3")               # Or ((7, 1), (5, 2)), as the Python engine writes moves
+//   >>> engine.find_best_move(movetime=200)     # Also depth=, nodes=; None if there is no legal move
+//   'g8f6'
+//   >>> engine.stats()["nodes"]
+//
+// find_best_move releases the GIL while it searches, so Python threads can run
+// searches on separate engines in parallel; another thread may call stop() to
+// end a search early. While an engine is searching every other method of it
+// raises RuntimeError.
+//
+// An Engine supports the buffer protocol: memoryview(engine), or
+// numpy.asarray(engine), is a read-only 8x8 int8 view of the board itself, not
+// a copy, with -1 for an empty square and otherwise the index of the piece in
+// cyrus.PIECES ("pPnNbBrRqQkK"). Row 0 is the eighth rank. The view follows
+// the game as moves are made, and moves about while a search is running.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <atomic>
+#include <new>
+#include <string>
+#include <vector>
+#include "Cyrus.h"
+
+struct EngineState {
+    CyrusEngine engine;
+    std::atomic<bool> stop{false};
+    bool searching = false;  // Changed only with the GIL held
+    std::vector<Move> pv;    // Of the last completed iteration
+};
+
+struct EngineObject {
+    PyObject_HEAD
+    EngineState* state;
+};
+
+static Py_ssize_t BOARD_SHAPE[2] = {8, 8};
+static Py_ssize_t BOARD_STRIDES[2] = {8, 1};
+
+static bool check_idle(EngineObject* self) {
+    if (!self->state->searching) return true;
+    PyErr_SetString(PyExc_RuntimeError, "engine is searching");
+    return false;
+}
+
+static PyObject* move_list(const std::vector<Move>& moves) {
+    PyObject* list = PyList_New(static_cast<Py_ssize_t>(moves.size()));
+    if (!list) return nullptr;
+    for (size_t i = 0; i < moves.size(); ++i) {
+        PyObject* text = PyUnicode_FromString(format_move(moves[i]).c_str());
+        if (!text) {
+            Py_DECREF(list);
+            return nullptr;
+        }
+        PyList_SET_ITEM(list, static_cast<Py_ssize_t>(i), text);
+    }
+    return list;
+}
+
+// "e2e4", or ((from_row, from_col), (to_row, to_col)) as PAP-Python-Cyrus.py writes moves
+static bool parse_move(PyObject* arg, Move& move) {
+    if (PyUnicode_Check(arg)) {
+        const char* text = PyUnicode_AsUTF8(arg);
+        if (!text) return false;
+        std::string s = text;
+        if (s.size() == 4 && s[0] >= 'a' && s[0] <= 'h' && s[1] >= '1' && s[1] <= '8'
+            && s[2] >= 'a' && s[2] <= 'h' && s[3] >= '1' && s[3] <= '8') {
+            move = {(8 - (s[1] - '0')) * 8 + (s[0] - 'a'), (8 - (s[3] - '0')) * 8 + (s[2] - 'a')};
+            return true;
+        }
+    } else {
+        int from_row, from_col, to_row, to_col;
+        if (PyArg_ParseTuple(arg, "(ii)(ii)", &from_row, &from_col, &to_row, &to_col)) {
+            if (from_row >= 0 && from_row < 8 && from_col >= 0 && from_col < 8
+                && to_row >= 0 && to_row < 8 && to_col >= 0 && to_col < 8) {
+                move = {from_row * 8 + from_col, to_row * 8 + to_col};
+                return true;
+            }
+        }
+        PyErr_Clear();
+    }
+    PyErr_Format(PyExc_ValueError, "not a move: %R", arg);
+    return false;
+}
+
+static PyObject* Engine_new(PyTypeObject* type, PyObject*, PyObject*) {
+    EngineObject* self = reinterpret_cast<EngineObject*>(type->tp_alloc(type, 0));
+    if (!self) return nullptr;
+    self->state = new (std::nothrow) EngineState;
+    if (!self->state) {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+    self->state->engine.on_iteration = [state = self->state](const SearchInfo& info) { state->pv = info.pv; };
+    return reinterpret_cast<PyObject*>(self);
+}
+
+static int Engine_init(EngineObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"fen", "hash_mb", "threads", nullptr};
+    const char* fen = START_FEN;
+    Py_ssize_t hash_mb = 16;
+    int threads = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|sni", const_cast<char**>(keywords), &fen, &hash_mb, &threads)) {
+        return -1;
+    }
+    if (!check_idle(self)) return -1;
+    CyrusEngine& engine = self->state->engine;
+    if (!engine.set_fen(fen)) {
+        PyErr_Format(PyExc_ValueError, "invalid FEN: %s", fen);
+        return -1;
+    }
+    try {
+        engine.set_hash_size(static_cast<size_t>(std::max<Py_ssize_t>(hash_mb, 1)));
+    } catch (const std::bad_alloc&) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    engine.search_threads = std::max(threads, 1);
+    return 0;
+}
+
+static void Engine_dealloc(EngineObject* self) {
+    delete self->state; // Never while searching: the search holds a reference
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject*>(self));
+}
+
+static int Engine_getbuffer(EngineObject* self, Py_buffer* view, int flags) {
+    if (flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "the board is read-only; use make_move or set_fen");
+        view->obj = nullptr;
+        return -1;
+    }
+    view->buf = const_cast<int8_t*>(self->state->engine.get_bitboards().mailbox);
+    view->obj = reinterpret_cast<PyObject*>(self);
+    Py_INCREF(self);
+    view->len = 64;
+    view->readonly = 1;
+    view->itemsize = 1;
+    view->format = (flags & PyBUF_FORMAT) ? const_cast<char*>("b") : nullptr;
+    view->ndim = 2;
+    view->shape = (flags & PyBUF_ND) == PyBUF_ND ? BOARD_SHAPE : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? BOARD_STRIDES : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    return 0;
+}
+
+static PyObject* Engine_fen(EngineObject* self, PyObject*) {
+    if (!check_idle(self)) return nullptr;
+    return PyUnicode_FromString(self->state->engine.get_fen().c_str());
+}
+
+static PyObject* Engine_set_fen(EngineObject* self, PyObject* args) {
+    const char* fen;
+    if (!PyArg_ParseTuple(args, "s", &fen) || !check_idle(self)) return nullptr;
+    if (!self->state->engine.set_fen(fen)) {
+        PyErr_Format(PyExc_ValueError, "invalid FEN: %s", fen);
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* Engine_legal_moves(EngineObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"sort", nullptr};
+    int sort = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|p", const_cast<char**>(keywords), &sort) || !check_idle(self)) {
+        return nullptr;
+    }
+    CyrusEngine& engine = self->state->engine;
+    return move_list(engine.get_all_legal_moves(engine.current_turn(), sort));
+}
+
+static PyObject* Engine_make_move(EngineObject* self, PyObject* arg) {
+    Move move;
+    if (!parse_move(arg, move) || !check_idle(self)) return nullptr;
+    CyrusEngine& engine = self->state->engine;
+    for (const Move& legal : engine.get_all_legal_moves(engine.current_turn())) {
+        if (legal == move) {
+            engine.make_move(legal);
+            Py_RETURN_NONE;
+        }
+    }
+    PyErr_Format(PyExc_ValueError, "illegal move: %R", arg);
+    return nullptr;
+}
+
+static PyObject* Engine_find_best_move(EngineObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"movetime", "depth", "nodes", nullptr};
+    long long movetime = 0;
+    int depth = 0;
+    unsigned long long nodes = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|$LiK", const_cast<char**>(keywords), &movetime, &depth, &nodes)
+        || !check_idle(self)) {
+        return nullptr;
+    }
+    EngineState* state = self->state;
+    SearchLimits limits;
+    limits.soft_time_ms = limits.hard_time_ms = std::max<long long>(movetime, 0);
+    limits.depth = std::max(depth, 0);
+    limits.nodes = nodes;
+    limits.stop = &state->stop;
+
+    // Held for the search, so the engine outlives it even if Python drops it
+    Py_INCREF(self);
+    state->searching = true;
+    state->stop = false;
+    state->pv.clear();
+    Move best;
+    Py_BEGIN_ALLOW_THREADS
+    best = state->engine.find_best_move(state->engine.current_turn(), limits);
+    Py_END_ALLOW_THREADS
+    state->searching = false;
+    Py_DECREF(self);
+
+    if (best.from == -1) Py_RETURN_NONE;
+    return PyUnicode_FromString(format_move(best).c_str());
+}
+
+static PyObject* Engine_stop(EngineObject* self, PyObject*) {
+    self->state->stop = true;
+    Py_RETURN_NONE;
+}
+
+static PyObject* Engine_stats(EngineObject* self, PyObject*) {
+    if (!check_idle(self)) return nullptr;
+    const SearchStats& s = self->state->engine.get_search_stats();
+    PyObject* pv = move_list(self->state->pv);
+    if (!pv) return nullptr;
+    return Py_BuildValue("{s:i,s:i,s:K,s:K,s:K,s:d,s:K,s:d,s:K,s:O,s:i,s:N}",
+                         "depth", s.depth, "score", s.score,
+                         "nodes", static_cast<unsigned long long>(s.total_nodes()),
+                         "qnodes", static_cast<unsigned long long>(s.qnodes),
+                         "nps", static_cast<unsigned long long>(s.nps()), "time_ms", s.time_ms,
+                         "tt_hits", static_cast<unsigned long long>(s.tt_hits), "tt_hit_rate", s.tt_hit_rate(),
+                         "tb_hits", static_cast<unsigned long long>(s.tb_hits), "book_hit", s.book_hit ? Py_True : Py_False,
+                         "threads", s.threads, "pv", pv);
+}
+
+static PyObject* Engine_is_in_check(EngineObject* self, PyObject*) {
+    if (!check_idle(self)) return nullptr;
+    CyrusEngine& engine = self->state->engine;
+    return PyBool_FromLong(engine.is_in_check(engine.current_turn()));
+}
+
+static PyObject* Engine_is_game_over(EngineObject* self, PyObject*) {
+    if (!check_idle(self)) return nullptr;
+    CyrusEngine& engine = self->state->engine;
+    return PyBool_FromLong(engine.is_game_over(engine.current_turn()));
+}
+
+static PyObject* Engine_new_game(EngineObject* self, PyObject*) {
+    if (!check_idle(self)) return nullptr;
+    self->state->engine.new_game();
+    Py_RETURN_NONE;
+}
+
+static PyObject* Engine_perft(EngineObject* self, PyObject* args) {
+    int depth;
+    if (!PyArg_ParseTuple(args, "i", &depth) || !check_idle(self)) return nullptr;
+    EngineState* state = self->state;
+    Py_INCREF(self);
+    state->searching = true;
+    uint64_t count;
+    Py_BEGIN_ALLOW_THREADS
+    count = state->engine.perft(std::max(depth, 0));
+    Py_END_ALLOW_THREADS
+    state->searching = false;
+    Py_DECREF(self);
+    return PyLong_FromUnsignedLongLong(count);
+}
+
+static PyObject* Engine_get_turn(EngineObject* self, void*) {
+    if (!check_idle(self)) return nullptr;
+    return PyUnicode_FromString(self->state->engine.current_turn() == 'w' ? "white" : "black");
+}
+
+static PyObject* Engine_get_hash(EngineObject* self, void*) {
+    if (!check_idle(self)) return nullptr;
+    return PyLong_FromUnsignedLongLong(self->state->engine.hash());
+}
+
+static PyMethodDef ENGINE_METHODS[] = {
+    {"fen", reinterpret_cast<PyCFunction>(Engine_fen), METH_NOARGS, "fen() -> str\n\nThe position as Shatranj FEN."},
+    {"set_fen", reinterpret_cast<PyCFunction>(Engine_set_fen), METH_VARARGS,
+     "set_fen(fen)\n\nSets up a position; ValueError if the FEN is malformed."},
+    {"legal_moves", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(Engine_legal_moves)), METH_VARARGS | METH_KEYWORDS,
+     "legal_moves(sort=False) -> list[str]\n\nMoves of the side to move, e.g. 'e2e4'; with sort, best-looking first."},
+    {"make_move", reinterpret_cast<PyCFunction>(Engine_make_move), METH_O,
+     "make_move(move)\n\nPlays 'e2e4' or ((6, 4), (4, 4)); ValueError if it is not legal."},
+    {"find_best_move", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(Engine_find_best_move)), METH_VARARGS | METH_KEYWORDS,
+     "find_best_move(*, movetime=0, depth=0, nodes=0) -> str | None\n\n"
+     "Searches the position without holding the GIL. Zero means no limit; with no\n"
+     "limits at all the search goes to a fixed shallow depth. None if there is no legal move."},
+    {"stop", reinterpret_cast<PyCFunction>(Engine_stop), METH_NOARGS,
+     "stop()\n\nEnds a running search early; it returns the best move found so far."},
+    {"stats", reinterpret_cast<PyCFunction>(Engine_stats), METH_NOARGS,
+     "stats() -> dict\n\nCounters of the last search: depth, score (White's view, centipawns), nodes, pv, ..."},
+    {"is_in_check", reinterpret_cast<PyCFunction>(Engine_is_in_check), METH_NOARGS, "Whether the side to move is in check."},
+    {"is_game_over", reinterpret_cast<PyCFunction>(Engine_is_game_over), METH_NOARGS,
+     "Whether the game has ended: no legal move, or bare kings."},
+    {"new_game", reinterpret_cast<PyCFunction>(Engine_new_game), METH_NOARGS,
+     "Forgets what earlier searches learned (hash table, move ordering); the position is kept."},
+    {"perft", reinterpret_cast<PyCFunction>(Engine_perft), METH_VARARGS,
+     "perft(depth) -> int\n\nLeaf nodes of the legal move tree, for testing move generation."},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static PyGetSetDef ENGINE_GETSET[] = {
+    {"turn", reinterpret_cast<getter>(Engine_get_turn), nullptr, "Side to move, 'white' or 'black'.", nullptr},
+    {"hash", reinterpret_cast<getter>(Engine_get_hash), nullptr, "Zobrist key of the position.", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr}
+};
+
+static PyBufferProcs ENGINE_BUFFER = {reinterpret_cast<getbufferproc>(Engine_getbuffer), nullptr};
+
+static PyTypeObject ENGINE_TYPE = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+static PyModuleDef CYRUS_MODULE = {
+    PyModuleDef_HEAD_INIT, "cyrus", "Shatranj engine Cyrus, in C++.", -1, nullptr, nullptr, nullptr, nullptr, nullptr
+};
+
+PyMODINIT_FUNC PyInit_cyrus() {
+    ENGINE_TYPE.tp_name = "cyrus.Engine";
+    ENGINE_TYPE.tp_doc = "Engine(fen=START_FEN, hash_mb=16, threads=1)\n\nOne game position with its own search.";
+    ENGINE_TYPE.tp_basicsize = sizeof(EngineObject);
+    ENGINE_TYPE.tp_flags = Py_TPFLAGS_DEFAULT;
+    ENGINE_TYPE.tp_new = Engine_new;
+    ENGINE_TYPE.tp_init = reinterpret_cast<initproc>(Engine_init);
+    ENGINE_TYPE.tp_dealloc = reinterpret_cast<destructor>(Engine_dealloc);
+    ENGINE_TYPE.tp_methods = ENGINE_METHODS;
+    ENGINE_TYPE.tp_getset = ENGINE_GETSET;
+    ENGINE_TYPE.tp_as_buffer = &ENGINE_BUFFER;
+    if (PyType_Ready(&ENGINE_TYPE) < 0) return nullptr;
+
+    PyObject* module = PyModule_Create(&CYRUS_MODULE);
+    if (!module) return nullptr;
+    Py_INCREF(&ENGINE_TYPE);
+    if (PyModule_AddObject(module, "Engine", reinterpret_cast<PyObject*>(&ENGINE_TYPE)) < 0
+        || PyModule_AddStringConstant(module, "START_FEN", START_FEN) < 0
+        || PyModule_AddStringConstant(module, "PIECES", PIECE_CHARS) < 0) {
+        Py_DECREF(&ENGINE_TYPE);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
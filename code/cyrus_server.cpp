@@ -0,0 +1,314 @@
+// cyrus-server: many concurrent games in one process.
+//
+// Reads requests from stdin and writes replies to stdout, one line each. A
+// session is one game with its own position; sessions cost a few kilobytes,
+// so thousands can be open at once. Searches from every session go to one
+// work-stealing thread pool with an engine per worker, and all the engines
+// share a single transposition table, so --hash caps the table memory of the
+// whole process.
+//
+//   g++ -O2 -std=c++17 -pthread Cyrus.cpp Position.cpp TranspositionTable.cpp MovePicker.cpp SearchStats.cpp MappedFile.cpp OpeningBook.cpp Tablebase.cpp Nnue.cpp ThreadPool.cpp cyrus_server.cpp -o cyrus-server
+//
+// Usage: cyrus-server [--threads N] [--hash MB] [--movetime MS] [--book FILE] [--tablebases DIR] [--nnue FILE]
+//
+// Requests, each starting with a session id of the client's choosing:
+//   <id> new [startpos | fen <FEN>] [moves <move>...]   Opens or resets the session
+//   <id> move <move>...                                Plays moves, e.g. "b1c3 g8f6"
+//   <id> go [movetime MS] [depth N] [nodes N]          Queues a search
+//   <id> stop                                          Ends the session's search early
+//   <id> fen
+//   <id> close
+// and two without one:
+//   stats   Throughput and latency since the server started
+//   quit    Waits for queued searches, then exits (as does the end of input)
+//
+// Replies start with the session id: "<id> ok", "<id> fen <FEN>", or
+// "<id> error <reason>" (unknown session, busy, illegal move, ...). A search
+// replies once it is done, in whatever order searches finish:
+//   <id> bestmove <move> score <cp> depth <N> nodes <N> time_ms <T> wait_ms <W>
+// with the score from the side to move's view and "0000" when there is no
+// legal move. A session with a search queued or running answers every
+// request but stop with "error busy".
+//
+// A go's time budget runs from the moment the request is read, so time spent
+// queued behind other searches is taken out of it; a search always completes
+// at least one iteration. Without movetime, depth or nodes, --movetime applies.
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include "Cyrus.h"
+#include "ThreadPool.h"
+
+using Clock = std::chrono::steady_clock;
+
+static double ms_between(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+struct Session {
+    Position position;
+    std::atomic<bool> busy{false}; // A search is queued or running; set by the reader, cleared by its worker
+    std::atomic<bool> stop{false};
+};
+
+// Completed searches, end-to-end latency (request read to reply written) and nodes
+class ServerMetrics {
+public:
+    // Returns the number of searches completed so far
+    uint64_t record(double latency_ms, uint64_t nodes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (latencies.size() < WINDOW) latencies.push_back(latency_ms);
+        else latencies[completed % WINDOW] = latency_ms;
+        total_nodes += nodes;
+        return ++completed;
+    }
+
+    // Latency percentiles cover the last WINDOW searches
+    std::string report(size_t sessions, size_t pending) {
+        std::vector<double> sorted;
+        uint64_t done, nodes;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            sorted = latencies;
+            done = completed;
+            nodes = total_nodes;
+        }
+        std::sort(sorted.begin(), sorted.end());
+        auto percentile = [&sorted](double p) {
+            return sorted.empty() ? 0.0 : sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+        };
+        double seconds = std::max(ms_between(started, Clock::now()) / 1000.0, 1e-9);
+        std::ostringstream out;
+        out.setf(std::ios::fixed);
+        out.precision(1);
+        out << "stats sessions " << sessions << " pending " << pending << " completed " << done
+            << " throughput " << done / seconds << " nps " << static_cast<uint64_t>(nodes / seconds)
+            << " latency_ms p50 " << percentile(0.50) << " p99 " << percentile(0.99)
+            << " max " << (sorted.empty() ? 0.0 : sorted.back());
+        return out.str();
+    }
+
+private:
+    static const size_t WINDOW = 1 << 16;
+    std::mutex mutex;
+    std::vector<double> latencies; // Ring of the most recent
+    uint64_t completed = 0;
+    uint64_t total_nodes = 0;
+    Clock::time_point started = Clock::now();
+};
+
+class GameServer {
+public:
+    GameServer(int threads, size_t hash_mb, int64_t default_movetime_ms,
+               std::shared_ptr<const OpeningBook> book, std::shared_ptr<const Tablebases> tablebases,
+               std::shared_ptr<const NnueNetwork> network)
+        : table(std::make_shared<TranspositionTable>(hash_mb)), default_movetime_ms(default_movetime_ms), pool(threads) {
+        table->new_search(); // Allocated up front: from here on workers only age it
+        for (int i = 0; i < pool.size(); ++i) {
+            engines.emplace_back(new CyrusEngine);
+            engines.back()->share_hash(table);
+            engines.back()->book = book;
+            engines.back()->tablebases = tablebases;
+            engines.back()->network = network;
+        }
+    }
+
+    void run(std::istream& in) {
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!execute(line)) break;
+        }
+        pool.wait_idle();
+    }
+
+    bool execute(const std::string& line) {
+        auto received = Clock::now();
+        std::istringstream args(line);
+        std::string id, command;
+        if (!(args >> id)) return true;
+        if (id == "quit") return false;
+        if (id == "stats") {
+            _send(metrics.report(sessions.size(), pool.pending()));
+            return true;
+        }
+        args >> command;
+
+        auto it = sessions.find(id);
+        if (command == "new" && it == sessions.end()) {
+            it = sessions.emplace(id, std::unique_ptr<Session>(new Session)).first;
+        }
+        if (it == sessions.end()) {
+            _send(id + " error unknown session");
+            return true;
+        }
+        Session& session = *it->second;
+        if (command == "stop") {
+            session.stop = true;
+        } else if (session.busy) {
+            _send(id + " error busy");
+        } else if (command == "new") {
+            _new_game(id, session, args);
+        } else if (command == "move") {
+            _play_moves(id, session, args);
+        } else if (command == "go") {
+            _go(id, session, args, received);
+        } else if (command == "fen") {
+            _send(id + " fen " + session.position.fen());
+        } else if (command == "close") {
+            sessions.erase(it);
+            _send(id + " ok");
+        } else {
+            _send(id + " error unknown command " + command);
+        }
+        return true;
+    }
+
+    std::string report() { return metrics.report(sessions.size(), pool.pending()); }
+
+private:
+    // A table generation spans this many searches, so entries left by games
+    // long finished are the first to be replaced
+    static const uint64_t SEARCHES_PER_GENERATION = 64;
+
+    void _send(const std::string& line) {
+        std::lock_guard<std::mutex> lock(out_mutex);
+        std::cout << line << std::endl;
+    }
+
+    void _new_game(const std::string& id, Session& session, std::istringstream& args) {
+        std::string token, fen;
+        Position position;
+        if (args >> token && token == "fen") {
+            while (args >> token && token != "moves") fen += (fen.empty() ? "" : " ") + token;
+            if (!position.set_fen(fen)) {
+                _send(id + " error invalid fen " + fen);
+                return;
+            }
+        } else if (token == "startpos") {
+            args >> token;
+        }
+        session.position = position;
+        _play_moves(id, session, args); // Whatever follows "moves"
+    }
+
+    // Plays moves in order up to the first illegal one
+    void _play_moves(const std::string& id, Session& session, std::istringstream& args) {
+        std::string token;
+        while (args >> token) {
+            referee.set_position(session.position);
+            auto legal = referee.get_all_legal_moves(referee.current_turn());
+            auto it = std::find_if(legal.begin(), legal.end(), [&token](const Move& m) { return format_move(m) == token; });
+            if (it == legal.end()) {
+                _send(id + " error illegal move " + token);
+                return;
+            }
+            session.position.play(*it);
+        }
+        _send(id + " ok");
+    }
+
+    void _go(const std::string& id, Session& session, std::istringstream& args, Clock::time_point received) {
+        SearchLimits limits;
+        int64_t move_time = 0;
+        std::string token;
+        while (args >> token) {
+            if (token == "movetime") args >> move_time;
+            else if (token == "depth") args >> limits.depth;
+            else if (token == "nodes") args >> limits.nodes;
+        }
+        if (!move_time && !limits.depth && !limits.nodes) move_time = default_movetime_ms;
+        limits.stop = &session.stop;
+
+        session.stop = false;
+        session.busy = true;
+        Position position = session.position;
+        pool.submit([this, id, &session, position, limits, move_time, received](int worker) mutable {
+            auto started = Clock::now();
+            if (move_time > 0) {
+                // The budget runs from the request, not from the start of the search
+                int64_t left = move_time - static_cast<int64_t>(ms_between(received, started));
+                limits.soft_time_ms = limits.hard_time_ms = std::max<int64_t>(left, 1);
+            }
+            CyrusEngine& engine = *engines[worker];
+            engine.set_position(position);
+            Move best = engine.find_best_move(engine.current_turn(), limits);
+            const SearchStats& stats = engine.get_search_stats();
+            int score = engine.current_turn() == 'w' ? stats.score : -stats.score;
+            if (best.from == -1) score = engine.is_in_check(engine.current_turn()) ? -CyrusEngine::MATE_SCORE : 0;
+
+            std::ostringstream reply;
+            reply << id << " bestmove " << (best.from == -1 ? "0000" : format_move(best)) << " score " << score
+                  << " depth " << stats.depth << " nodes " << stats.total_nodes()
+                  << " time_ms " << static_cast<int64_t>(stats.time_ms)
+                  << " wait_ms " << static_cast<int64_t>(ms_between(received, started));
+            session.busy = false; // Before the reply, so the client's next request finds it free
+            _send(reply.str());
+            if (metrics.record(ms_between(received, Clock::now()), stats.total_nodes()) % SEARCHES_PER_GENERATION == 0) {
+                table->new_search();
+            }
+        });
+    }
+
+    std::shared_ptr<TranspositionTable> table;
+    int64_t default_movetime_ms;
+    std::vector<std::unique_ptr<CyrusEngine>> engines; // One per pool worker
+    CyrusEngine referee; // Checks moves on the reader thread
+    std::unordered_map<std::string, std::unique_ptr<Session>> sessions; // Reader thread only
+    std::mutex out_mutex;
+    ServerMetrics metrics;
+    ThreadPool pool; // Last, so its workers are joined before the rest is destroyed
+};
+
+int main(int argc, char** argv) {
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t hash_mb = 256;
+    int64_t movetime = 100;
+    std::shared_ptr<OpeningBook> book;
+    std::shared_ptr<Tablebases> tablebases;
+    std::shared_ptr<NnueNetwork> network;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--hash" && i + 1 < argc) hash_mb = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--movetime" && i + 1 < argc) movetime = std::max<int64_t>(1, std::atoll(argv[++i]));
+        else if (arg == "--book" && i + 1 < argc) {
+            book = std::make_shared<OpeningBook>();
+            if (!book->open(argv[++i])) {
+                std::cerr << "Cannot open book " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--tablebases" && i + 1 < argc) {
+            tablebases = std::make_shared<Tablebases>();
+            if (!tablebases->open(argv[++i])) {
+                std::cerr << "No tablebases in " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--nnue" && i + 1 < argc) {
+            network = std::make_shared<NnueNetwork>();
+            if (!network->open(argv[++i])) {
+                std::cerr << "Cannot open network " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else {
+            std::cerr << "Usage: cyrus-server [--threads N] [--hash MB] [--movetime MS] [--book FILE] [--tablebases DIR] [--nnue FILE]" << std::endl;
+            return 2;
+        }
+    }
+
+    GameServer server(threads, hash_mb, movetime, book, tablebases, network);
+    server.run(std::cin);
+    std::cerr << server.report() << std::endl;
+    return 0;
+}
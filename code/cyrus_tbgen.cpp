@@ -0,0 +1,323 @@
+// cyrus-tbgen: builds the endgame tablebases by retrograde analysis.
+//
+//   g++ -O2 -std=c++17 -pthread MappedFile.cpp Tablebase.cpp cyrus_tbgen.cpp -o cyrus-tbgen
+//
+// Usage: cyrus-tbgen [--pieces 3|4] [--threads N] [DIR]
+//
+// Writes one file per material combination into DIR (default "."), all 3-piece
+// tables and, unless --pieces 3, all 4-piece ones. Tables are generated in
+// order of piece count and then pawn count, so every capture or promotion
+// leads into a table already in memory; tables at the same stage are built in
+// parallel, one per thread.
+//
+// Each table is solved backwards from its mates. A position is won as soon as
+// one move reaches a lost position, and lost once every move has been found to
+// reach a won one, so positions are finished in order of distance to mate and
+// whatever is never finished is a draw.
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include "Attacks.h"
+#include "Tablebase.h"
+
+static const uint8_t INVALID = 0xFF; // moves_left of an unreachable position
+static const uint8_t NO_WIN = 0xFF;
+static const int MAX_DTM = 254;      // Distances are stored plus one in a byte
+
+// Finished tables by TablebaseMaterial::key. Every slot exists before any
+// thread starts, and a slot is only read once its stage is complete.
+using TableStore = std::map<uint64_t, std::vector<uint8_t>>;
+
+class TableGenerator {
+public:
+    TableGenerator(const TablebaseMaterial& material, const TableStore& finished)
+        : material(material), finished(finished), n(material.count) {}
+
+    // Fills `values` with one byte per position, as Tablebases::write expects
+    bool generate(std::vector<uint8_t>& values, std::string& error);
+
+private:
+    void _decode(uint64_t index, int squares[], int& side_to_move) const {
+        for (int i = 0; i < n; ++i) squares[i] = static_cast<int>((index >> (6 * i)) & 63);
+        side_to_move = (index >> (6 * n)) ? BLACK : WHITE;
+    }
+    bool _setup(const int squares[], Bitboards& bb) const;
+    bool _attacked(const Bitboards& bb, int sq, int by_color) const {
+        return attacks::attackers_to(bb, sq, bb.occupied) & bb.occupancy[by_color];
+    }
+    uint64_t _targets(const Bitboards& bb, int piece, int sq) const;
+    TablebaseResult _probe_finished(const Bitboards& bb, int side_to_move) const;
+    void _initialize(uint64_t index);
+    bool _push(uint64_t index, int dtm);
+    void _retract(uint64_t index, int dtm);
+
+    const TablebaseMaterial& material;
+    const TableStore& finished;
+    int n;
+    std::vector<uint8_t> result;     // Final values, 0 until finished
+    std::vector<uint8_t> moves_left; // Moves not yet known to lose, INVALID if unreachable
+    std::vector<uint8_t> win_dtm;    // Shortest win found so far
+    std::vector<uint8_t> loss_dtm;   // Longest defence found so far
+    std::vector<std::vector<uint32_t>> pending; // Positions to finish, by distance to mate
+    bool overflow = false;
+};
+
+bool TableGenerator::_setup(const int squares[], Bitboards& bb) const {
+    bb.clear();
+    for (int i = 0; i < n; ++i) {
+        int sq = squares[i];
+        if (bb.piece_on(sq) != NO_PIECE) return false;
+        if (piece_type(material.pieces[i]) == PAWN && (sq < 8 || sq >= 56)) return false; // Would have promoted
+        bb.put(material.pieces[i], sq);
+    }
+    return true;
+}
+
+uint64_t TableGenerator::_targets(const Bitboards& bb, int piece, int sq) const {
+    int color = piece_color(piece);
+    uint64_t own = bb.occupancy[color];
+    switch (piece_type(piece)) {
+        case PAWN: {
+            int ahead = color == WHITE ? sq - 8 : sq + 8;
+            uint64_t push = bb.piece_on(ahead) == NO_PIECE ? square_bb(ahead) : 0;
+            return push | (attacks::PAWN_ATTACKS[color][sq] & bb.occupancy[1 - color]);
+        }
+        case FARAS: return attacks::FARAS_ATTACKS[sq] & ~own;
+        case FIL: return attacks::FIL_ATTACKS[sq] & ~own;
+        case FERZ: return attacks::FERZ_ATTACKS[sq] & ~own;
+        case SHAH: return attacks::SHAH_ATTACKS[sq] & ~own;
+        default: return attacks::rukh_attacks(sq, bb.occupied) & ~own;
+    }
+}
+
+TablebaseResult TableGenerator::_probe_finished(const Bitboards& bb, int side_to_move) const {
+    TablebaseResult none;
+    if (popcount(bb.occupied) == 2) return none;
+    int squares[TablebaseMaterial::MAX_PIECES] = {};
+    for (bool mirrored : {false, true}) {
+        TablebaseMaterial m = TablebaseMaterial::of(bb, mirrored, squares);
+        auto it = finished.find(m.key());
+        if (it == finished.end() || it->second.empty()) continue;
+        return Tablebases::decode(it->second[m.index(squares, mirrored ? 1 - side_to_move : side_to_move)]);
+    }
+    return none; // Unreachable: every smaller table is generated first
+}
+
+bool TableGenerator::_push(uint64_t index, int dtm) {
+    if (dtm > MAX_DTM) {
+        overflow = true;
+        return false;
+    }
+    pending[dtm].push_back(static_cast<uint32_t>(index));
+    return true;
+}
+
+// Counts the moves of one position and settles it at once when they all leave
+// the table: mated, stalemated, or every move a capture or promotion.
+void TableGenerator::_initialize(uint64_t index) {
+    int squares[TablebaseMaterial::MAX_PIECES] = {};
+    int side_to_move;
+    _decode(index, squares, side_to_move);
+    Bitboards bb;
+    int them = 1 - side_to_move;
+    if (!_setup(squares, bb) || _attacked(bb, lsb(bb.of(SHAH, them)), side_to_move)) {
+        moves_left[index] = INVALID;
+        return;
+    }
+
+    int moves = 0, in_table = 0;
+    int best_win = NO_WIN, worst_loss = 0;
+    for (int i = 0; i < n; ++i) {
+        int piece = material.pieces[i];
+        if (piece_color(piece) != side_to_move) continue;
+        uint64_t targets = _targets(bb, piece, squares[i]);
+        while (targets) {
+            int to = pop_lsb(targets);
+            Bitboards after = bb;
+            int captured = after.piece_on(to);
+            after.remove(piece, squares[i]);
+            if (captured != NO_PIECE) after.remove(captured, to);
+            bool promotes = piece_type(piece) == PAWN && (to < 8 || to >= 56);
+            after.put(promotes ? make_piece(FERZ, side_to_move) : piece, to);
+            if (_attacked(after, lsb(after.of(SHAH, side_to_move)), them)) continue;
+            ++moves;
+            if (captured == NO_PIECE && !promotes) {
+                ++in_table;
+                continue;
+            }
+            TablebaseResult child = _probe_finished(after, them);
+            if (child.wdl < 0) best_win = std::min(best_win, child.dtm + 1);
+            else if (child.wdl == 0) ++in_table; // A way out that is never refuted
+            else worst_loss = std::max(worst_loss, child.dtm + 1);
+        }
+    }
+
+    moves_left[index] = static_cast<uint8_t>(in_table);
+    loss_dtm[index] = static_cast<uint8_t>(std::min(worst_loss, static_cast<int>(NO_WIN)));
+    if (moves == 0) {
+        if (_attacked(bb, lsb(bb.of(SHAH, side_to_move)), them)) _push(index, 0); // Mated; stalemate stays a draw
+    } else if (best_win != NO_WIN) {
+        win_dtm[index] = static_cast<uint8_t>(std::min(best_win, static_cast<int>(NO_WIN)));
+        _push(index, best_win);
+    } else if (in_table == 0) {
+        _push(index, worst_loss);
+    }
+}
+
+// Passes a finished position back to every position one quiet move earlier,
+// with the other side to move. Captures and promotions come from other tables.
+void TableGenerator::_retract(uint64_t index, int dtm) {
+    int squares[TablebaseMaterial::MAX_PIECES] = {};
+    int side_to_move;
+    _decode(index, squares, side_to_move);
+    Bitboards bb;
+    _setup(squares, bb);
+    int mover = 1 - side_to_move;
+    bool lost = (dtm & 1) == 0;
+
+    for (int i = 0; i < n; ++i) {
+        int piece = material.pieces[i];
+        if (piece_color(piece) != mover) continue;
+        int sq = squares[i];
+        uint64_t origins;
+        if (piece_type(piece) == PAWN) {
+            int behind = mover == WHITE ? sq + 8 : sq - 8;
+            bool start_ok = behind >= 8 && behind < 56 && bb.piece_on(behind) == NO_PIECE;
+            origins = start_ok ? square_bb(behind) : 0;
+        } else {
+            // Every other piece moves the same way in both directions
+            origins = _targets(bb, piece, sq) & ~bb.occupied;
+        }
+        while (origins) {
+            int from = pop_lsb(origins);
+            int before[TablebaseMaterial::MAX_PIECES];
+            std::copy(squares, squares + n, before);
+            before[i] = from;
+            uint64_t prev = material.index(before, mover);
+            if (moves_left[prev] == INVALID || result[prev]) continue;
+            if (lost) {
+                if (win_dtm[prev] > dtm + 1) {
+                    win_dtm[prev] = static_cast<uint8_t>(std::min(dtm + 1, static_cast<int>(NO_WIN)));
+                    _push(prev, dtm + 1);
+                }
+            } else if (win_dtm[prev] == NO_WIN) {
+                loss_dtm[prev] = static_cast<uint8_t>(std::max<int>(loss_dtm[prev], dtm + 1));
+                if (--moves_left[prev] == 0) _push(prev, loss_dtm[prev]);
+            }
+        }
+    }
+}
+
+bool TableGenerator::generate(std::vector<uint8_t>& values, std::string& error) {
+    uint64_t size = material.size();
+    result.assign(size, 0);
+    moves_left.assign(size, 0);
+    win_dtm.assign(size, NO_WIN);
+    loss_dtm.assign(size, 0);
+    pending.assign(MAX_DTM + 1, {});
+
+    for (uint64_t index = 0; index < size; ++index) _initialize(index);
+    for (int dtm = 0; dtm <= MAX_DTM && !overflow; ++dtm) {
+        // Entries only ever go to later distances, so this list is stable
+        for (size_t k = 0; k < pending[dtm].size(); ++k) {
+            uint64_t index = pending[dtm][k];
+            if (result[index]) continue; // Already finished closer to mate
+            result[index] = static_cast<uint8_t>(dtm + 1);
+            _retract(index, dtm);
+        }
+        std::vector<uint32_t>().swap(pending[dtm]);
+    }
+    if (overflow) {
+        error = "a mate is longer than " + std::to_string(MAX_DTM) + " plies";
+        return false;
+    }
+
+    // Unreachable positions take the previous value, lengthening the runs
+    values.swap(result);
+    uint8_t previous = 0;
+    for (uint64_t index = 0; index < size; ++index) {
+        if (moves_left[index] == INVALID) values[index] = previous;
+        previous = values[index];
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int max_pieces = TablebaseMaterial::MAX_PIECES;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string directory = ".";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--pieces" && i + 1 < argc) max_pieces = std::atoi(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc) threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg[0] != '-') directory = arg;
+        else max_pieces = 0; // Unknown option
+    }
+    if (max_pieces < 3 || max_pieces > TablebaseMaterial::MAX_PIECES) {
+        std::cerr << "Usage: cyrus-tbgen [--pieces 3|4] [--threads N] [DIR]" << std::endl;
+        return 2;
+    }
+
+    // Stages: tables that only depend on earlier stages
+    std::vector<std::vector<TablebaseMaterial>> stages;
+    int last_stage = -1;
+    for (const TablebaseMaterial& m : TablebaseMaterial::all()) {
+        if (m.count > max_pieces) continue;
+        int pawns = 0;
+        for (int i = 0; i < m.count; ++i) pawns += piece_type(m.pieces[i]) == PAWN;
+        int stage = m.count * 8 + pawns;
+        if (stage != last_stage) stages.emplace_back();
+        stages.back().push_back(m);
+        last_stage = stage;
+    }
+
+    TableStore finished;
+    for (const auto& stage : stages) {
+        for (const auto& m : stage) finished[m.key()];
+    }
+
+    std::mutex report_mutex;
+    bool failed = false;
+    for (const auto& stage : stages) {
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < std::min<int>(threads, static_cast<int>(stage.size())); ++t) {
+            workers.emplace_back([&]() {
+                for (size_t k = next++; k < stage.size(); k = next++) {
+                    const TablebaseMaterial& m = stage[k];
+                    auto start = std::chrono::steady_clock::now();
+                    std::vector<uint8_t> values;
+                    std::string error;
+                    TableGenerator generator(m, finished);
+                    bool ok = generator.generate(values, error);
+                    std::string path = directory + "/" + Tablebases::file_name(m);
+                    if (ok && !Tablebases::write(path, m, values)) error = "cannot write " + path;
+
+                    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    std::lock_guard<std::mutex> lock(report_mutex);
+                    if (!error.empty()) {
+                        std::cerr << m.name() << ": " << error << std::endl;
+                        failed = true;
+                        continue;
+                    }
+                    int longest = 0;
+                    for (uint8_t v : values) longest = std::max(longest, Tablebases::decode(v).dtm);
+                    std::cout << m.name() << ": " << values.size() << " positions, longest mate " << longest
+                              << " plies, " << seconds << " s" << std::endl;
+                    // Read by the later stages, after this one's threads are joined
+                    finished.at(m.key()).swap(values);
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+        if (failed) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,264 @@
+// cyrus-tune: fits the material and piece-square tables to training data.
+//
+// Texel's method: the evaluation of each position, passed through a logistic
+// curve, should predict the result of the game it came from. The tuner first
+// fits the curve's scale K to the current tables, then moves every table entry
+// down the gradient of the mean squared prediction error (with Adam steps),
+// spreading each epoch over all threads. The new tables are printed as C++ in
+// the layout of Evaluation.h, ready to paste over the old ones.
+//
+//   g++ -O2 -std=c++17 -pthread TrainingData.cpp cyrus_tune.cpp -o cyrus-tune
+//
+// Usage: cyrus-tune [--threads N] [--epochs N] [--rate CP] [--lambda L] [--k K]
+//                   [--max-positions N] [--out FILE] FILE...
+//
+// The target is the game result blended with the search score through the
+// same curve: (1 - lambda) * result + lambda * sigmoid(score). The Shah's
+// material value cancels out and is left alone, as is every entry for a
+// square where the data never has that piece.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "Evaluation.h"
+#include "TrainingData.h"
+
+static const int PARAMETERS = 6 * 64;
+static const char* const PIECE_NAMES[6] = {"Pawn", "Faras (Knight)", "Fil (Elephant)", "Rukh (Rook)", "Ferz (Counselor)", "Shah (King)"};
+
+// Table entry read for a piece: White reads PST[type][sq], Black the row-mirrored square
+static int parameter(int piece, int square) {
+    int type = piece_type(piece);
+    return type * 64 + (piece_color(piece) == WHITE ? square : square ^ 56);
+}
+
+static double evaluate(const TrainingRecord& record, const double* weights) {
+    double score = 0;
+    int n = 0;
+    for (uint64_t b = record.occupied; b && n < 32; ++n) {
+        int square = pop_lsb(b);
+        int piece = record.pieces[n / 2] >> (n % 2 * 4) & 15;
+        score += piece_color(piece) == WHITE ? weights[parameter(piece, square)] : -weights[parameter(piece, square)];
+    }
+    return score;
+}
+
+static double sigmoid(double score, double k) {
+    return 1.0 / (1.0 + std::pow(10.0, -k * score / 400.0));
+}
+
+class Tuner {
+public:
+    Tuner(const std::vector<TrainingRecord>& positions, int threads, double lambda)
+        : positions(positions), threads(threads), lambda(lambda) {}
+
+    // Mean squared error over all positions; with `gradient` also adds its
+    // derivative with respect to each weight
+    double error(const double* weights, double k, double* gradient = nullptr) const {
+        std::vector<double> errors(threads, 0.0);
+        std::vector<std::vector<double>> gradients(gradient ? threads : 0, std::vector<double>(PARAMETERS, 0.0));
+        std::vector<std::thread> workers;
+        size_t chunk = (positions.size() + threads - 1) / threads;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                size_t begin = std::min(positions.size(), t * chunk), end = std::min(positions.size(), begin + chunk);
+                double sum = 0;
+                double* g = gradient ? gradients[t].data() : nullptr;
+                for (size_t i = begin; i < end; ++i) {
+                    const TrainingRecord& record = positions[i];
+                    double predicted = sigmoid(evaluate(record, weights), k);
+                    double target = (1 - lambda) * (record.result + 1) / 2.0 + lambda * sigmoid(record.score, k);
+                    double difference = predicted - target;
+                    sum += difference * difference;
+                    if (!g) continue;
+                    // d(error)/d(eval), then spread over the weights the eval summed
+                    double slope = 2 * difference * predicted * (1 - predicted) * k * std::log(10.0) / 400.0;
+                    int n = 0;
+                    for (uint64_t b = record.occupied; b && n < 32; ++n) {
+                        int square = pop_lsb(b);
+                        int piece = record.pieces[n / 2] >> (n % 2 * 4) & 15;
+                        g[parameter(piece, square)] += piece_color(piece) == WHITE ? slope : -slope;
+                    }
+                }
+                errors[t] = sum;
+            });
+        }
+        for (auto& w : workers) w.join();
+
+        double total = 0;
+        for (double e : errors) total += e;
+        double count = std::max<double>(static_cast<double>(positions.size()), 1);
+        if (gradient) {
+            for (int p = 0; p < PARAMETERS; ++p) {
+                gradient[p] = 0;
+                for (const auto& g : gradients) gradient[p] += g[p];
+                gradient[p] /= count;
+            }
+        }
+        return total / count;
+    }
+
+    // Scale of the logistic curve that best fits the results to `weights`, by golden-section search
+    double fit_k(const double* weights) const {
+        const double ratio = (std::sqrt(5.0) - 1) / 2;
+        double low = 0.05, high = 5.0;
+        double a = high - ratio * (high - low), b = low + ratio * (high - low);
+        double error_a = error(weights, a), error_b = error(weights, b);
+        while (high - low > 0.001) {
+            if (error_a < error_b) {
+                high = b;
+                b = a;
+                error_b = error_a;
+                a = high - ratio * (high - low);
+                error_a = error(weights, a);
+            } else {
+                low = a;
+                a = b;
+                error_a = error_b;
+                b = low + ratio * (high - low);
+                error_b = error(weights, b);
+            }
+        }
+        return (low + high) / 2;
+    }
+
+private:
+    const std::vector<TrainingRecord>& positions;
+    int threads;
+    double lambda;
+};
+
+static void print_tables(std::ostream& out, const int values[6], const int pst[6][64]) {
+    out << "inline constexpr int PIECE_VALUES[6] = {";
+    for (int type = 0; type < 6; ++type) out << values[type] << (type < 5 ? ", " : "};\n\n");
+    out << "inline constexpr int PST[6][64] = {\n";
+    for (int type = 0; type < 6; ++type) {
+        out << "    // " << PIECE_NAMES[type] << "\n    {\n";
+        for (int row = 0; row < 8; ++row) {
+            out << "       ";
+            for (int col = 0; col < 8; ++col) {
+                out << ' ' << std::setw(3) << pst[type][row * 8 + col] << (row < 7 || col < 7 ? "," : "");
+            }
+            out << '\n';
+        }
+        out << (type < 5 ? "    },\n" : "    }\n");
+    }
+    out << "};\n";
+}
+
+static int usage() {
+    std::cerr << "Usage: cyrus-tune [--threads N] [--epochs N] [--rate CP] [--lambda L] [--k K]\n"
+                 "                  [--max-positions N] [--out FILE] FILE..." << std::endl;
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    int epochs = 300;
+    double rate = 1.0;
+    double lambda = 0.5;
+    double k = 0; // Fitted unless given
+    uint64_t max_positions = 0;
+    std::string out_path;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--threads" && has_value) threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--epochs" && has_value) epochs = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--rate" && has_value) rate = std::atof(argv[++i]);
+        else if (arg == "--lambda" && has_value) lambda = std::min(std::max(std::atof(argv[++i]), 0.0), 1.0);
+        else if (arg == "--k" && has_value) k = std::atof(argv[++i]);
+        else if (arg == "--max-positions" && has_value) max_positions = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--out" && has_value) out_path = argv[++i];
+        else if (arg[0] != '-') paths.push_back(arg);
+        else return usage();
+    }
+    if (paths.empty()) return usage();
+
+    std::vector<TrainingRecord> positions;
+    for (const std::string& path : paths) {
+        TrainingReader reader;
+        if (!reader.open(path)) {
+            std::cerr << "Not a training file: " << path << std::endl;
+            return 1;
+        }
+        while ((!max_positions || positions.size() < max_positions) && reader.read_block(positions)) {}
+    }
+    if (max_positions && positions.size() > max_positions) positions.resize(max_positions);
+    if (positions.empty()) {
+        std::cerr << "No positions to tune on" << std::endl;
+        return 1;
+    }
+
+    // One weight per table entry: material plus PST, except for the Shah
+    double weights[PARAMETERS];
+    for (int type = 0; type < 6; ++type) {
+        for (int sq = 0; sq < 64; ++sq) weights[type * 64 + sq] = (type == SHAH ? 0 : PIECE_VALUES[type]) + PST[type][sq];
+    }
+    // Squares a piece type is ever read on; the others keep their entries
+    bool seen[PARAMETERS] = {};
+    for (const TrainingRecord& record : positions) {
+        int n = 0;
+        for (uint64_t b = record.occupied; b && n < 32; ++n) {
+            int square = pop_lsb(b);
+            seen[parameter(record.pieces[n / 2] >> (n % 2 * 4) & 15, square)] = true;
+        }
+    }
+
+    Tuner tuner(positions, threads, lambda);
+    if (k <= 0) k = tuner.fit_k(weights);
+    std::cerr << positions.size() << " positions, K " << std::fixed << std::setprecision(3) << k << ", error "
+              << std::setprecision(6) << tuner.error(weights, k) << std::endl;
+
+    // Adam, with the step size in centipawns
+    const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+    std::vector<double> gradient(PARAMETERS), m(PARAMETERS, 0.0), v(PARAMETERS, 0.0);
+    for (int epoch = 1; epoch <= epochs; ++epoch) {
+        double e = tuner.error(weights, k, gradient.data());
+        for (int p = 0; p < PARAMETERS; ++p) {
+            if (!seen[p]) continue;
+            m[p] = beta1 * m[p] + (1 - beta1) * gradient[p];
+            v[p] = beta2 * v[p] + (1 - beta2) * gradient[p] * gradient[p];
+            double m_hat = m[p] / (1 - std::pow(beta1, epoch)), v_hat = v[p] / (1 - std::pow(beta2, epoch));
+            weights[p] -= rate * m_hat / (std::sqrt(v_hat) + epsilon);
+        }
+        if (epoch % 10 == 0 || epoch == epochs) std::cerr << "Epoch " << epoch << " error " << e << std::endl;
+    }
+    std::cerr << "Final error " << tuner.error(weights, k) << std::endl;
+
+    // Material moves by the mean change over the squares a type was seen on and
+    // the PST takes the rest, so every entry sums to its tuned weight
+    int values[6], pst[6][64];
+    for (int type = 0; type < 6; ++type) {
+        double shift = 0;
+        int count = 0;
+        for (int sq = 0; sq < 64; ++sq) {
+            if (!seen[type * 64 + sq]) continue;
+            shift += weights[type * 64 + sq] - (type == SHAH ? 0 : PIECE_VALUES[type]) - PST[type][sq];
+            ++count;
+        }
+        values[type] = PIECE_VALUES[type] + (type == SHAH || !count ? 0 : static_cast<int>(std::lround(shift / count)));
+        int base = type == SHAH ? 0 : values[type];
+        for (int sq = 0; sq < 64; ++sq) pst[type][sq] = static_cast<int>(std::lround(weights[type * 64 + sq])) - base;
+    }
+
+    if (out_path.empty()) {
+        print_tables(std::cout, values, pst);
+        return 0;
+    }
+    std::ofstream out(out_path);
+    print_tables(out, values, pst);
+    if (!out) {
+        std::cerr << "Cannot write " << out_path << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -2,6 +2,10 @@
 #include <string>
 #include <vector>
 #include "Cyrus.h"
+#include "Uci.h"
+
+// Maximum time the engine thinks per move, like MAX_SEARCH_TIME in the Python version
+const int64_t MAX_SEARCH_TIME_MS = 5000;
 
 // Function to parse user input like "e2e4" into a Move object
 Move parse_move(const std::string& move_str, const std::vector<Move>& legal_moves) {
@@ -28,19 +32,14 @@ Move parse_move(const std::string& move_str, const std::vector<Move>& legal_move
     return {-1, -1}; // Not found in legal moves
 }
 
-// Function to format a Move object into a string like "e2e4"
-std::string format_move(const Move& move) {
-    if (move.from == -1) return "NULL";
-    std::string str;
-    str += (char)('a' + (move.from % 8));
-    str += std::to_string(8 - (move.from / 8));
-    str += (char)('a' + (move.to % 8));
-    str += std::to_string(8 - (move.to / 8));
-    return str;
-}
 
+int main(int argc, char** argv) {
+    // Protocol mode, selected by "cyrus uci" or by answering the first prompt with "uci"
+    if (argc > 1 && std::string(argv[1]) == "uci") {
+        UciProtocol().run();
+        return 0;
+    }
 
-int main() {
     CyrusEngine engine;
     std::string player_color_str;
     char player_color = ' ';
@@ -49,6 +48,12 @@ int main() {
     while (player_color == ' ') {
         std::cout << "Do you want to play as (white/black)? ";
         std::cin >> player_color_str;
+        if (player_color_str == "uci") {
+            UciProtocol protocol;
+            protocol.execute("uci");
+            protocol.run();
+            return 0;
+        }
         if (player_color_str == "white") player_color = 'w';
         else if (player_color_str == "black") player_color = 'b';
         else std::cout << "Invalid choice. Please enter 'white' or 'black'." << std::endl;
@@ -57,12 +62,12 @@ int main() {
     while (true) {
         engine.print_board();
         
-        if (engine.is_game_over(engine.current_turn)) {
-            std::cout << "Game Over: " << engine.get_game_over_message(engine.current_turn) << std::endl;
+        if (engine.is_game_over(engine.current_turn())) {
+            std::cout << "Game Over: " << engine.get_game_over_message(engine.current_turn()) << std::endl;
             break;
         }
 
-        if (engine.current_turn == player_color) {
+        if (engine.current_turn() == player_color) {
             Move move = {-1, -1};
             while (move.from == -1) {
                 std::string turn_name = (player_color == 'w') ? "white" : "black";
@@ -84,12 +89,17 @@ int main() {
             std::cout << "Cyrus (" << turn_name << ") is thinking..." << std::endl;
 
             auto start = std::chrono::high_resolution_clock::now();
-            Move best_move = engine.find_best_move(engine_turn);
+            SearchLimits limits;
+            limits.soft_time_ms = MAX_SEARCH_TIME_MS / 2;
+            limits.hard_time_ms = MAX_SEARCH_TIME_MS;
+            Move best_move = engine.find_best_move(engine_turn, limits);
             auto stop = std::chrono::high_resolution_clock::now();
             auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
             
+            const SearchStats& stats = engine.get_search_stats();
             std::cout << "Cyrus plays: " << format_move(best_move) 
-                      << " (Found in " << duration.count() / 1000.0 << "s)" << std::endl;
+                      << " (Found in " << duration.count() / 1000.0 << "s, depth " << stats.depth
+                      << ", " << stats.total_nodes() << " nodes, " << stats.nps() << " nps)" << std::endl;
             engine.make_move(best_move);
         }
     }
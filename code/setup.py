@@ -0,0 +1,25 @@
+# Builds the cyrus Python module (see cyrus_python.cpp):
+#
+#   python3 setup.py build_ext --inplace    # cyrus*.so in this directory
+#   pip install .                           # or into the current environment
+from setuptools import setup, Extension
+
+ENGINE_SOURCES = [
+    "Cyrus.cpp", "Position.cpp", "TranspositionTable.cpp", "MovePicker.cpp", "SearchStats.cpp",
+    "MappedFile.cpp", "OpeningBook.cpp", "Tablebase.cpp", "Nnue.cpp",
+]
+
+setup(
+    name="cyrus",
+    version="1.1.0",
+    description="Python bindings for the Cyrus Shatranj engine",
+    ext_modules=[
+        Extension(
+            "cyrus",
+            sources=ENGINE_SOURCES + ["cyrus_python.cpp"],
+            language="c++",
+            extra_compile_args=["-std=c++17", "-O2"],
+            extra_link_args=["-pthread"],
+        )
+    ],
+)